@@ -0,0 +1,275 @@
+#include "AVLImport.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Entry = std::pair<std::string_view, size_t>;
+
+    // keys and values parsed from one piece of a block, sorted by key. The key views point into keyBytes
+    struct ParsedPiece {
+        std::vector<char> keyBytes;
+        std::vector<Entry> entries;
+        size_t malformedLines = 0;
+    };
+
+    bool isBlank(char c) {
+        return c == ' ' or c == '\t';
+    }
+
+    /*
+     *  parseLine - split one line into its key and value
+     *
+     *  params
+     *      line - the line without its line end or trailing blanks
+     *      delimiter - separator before the value, 0 for a run of spaces or tabs
+     *      key - set to the key
+     *      value - set to the value
+     *
+     *  returns - false if the line has no separator, an empty key or a value that is not a number
+     */
+    bool parseLine(std::string_view line, char delimiter, std::string_view& key, size_t& value) {
+        size_t split = delimiter == 0 ? line.find_last_of(" \t") : line.rfind(delimiter);
+        if (split == std::string_view::npos) {
+            return false;
+        }
+        std::string_view field = line.substr(split + 1);
+        key = line.substr(0, split);
+        while (!key.empty() and isBlank(key.back())) {
+            key.remove_suffix(1);
+        }
+        while (!field.empty() and isBlank(field.front())) {
+            field.remove_prefix(1);
+        }
+        if (key.empty() or field.empty()) {
+            return false;
+        }
+        auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+        return error == std::errc() and end == field.data() + field.size();
+    }
+
+    /*
+     *  parsePiece - parse every line of text and sort the result. The keys are copied into one buffer reserved
+     *      up front so the views into it stay valid. The sort is stable so repeated keys stay in file order
+     *
+     *  params
+     *      text - whole lines of the file
+     *      delimiter - separator before the value, 0 for a run of spaces or tabs
+     *      piece - filled with the parsed keys
+     */
+    void parsePiece(std::string_view text, char delimiter, ParsedPiece& piece) {
+        piece.keyBytes.reserve(text.size());
+        while (!text.empty()) {
+            size_t lineEnd = text.find('\n');
+            std::string_view line = text.substr(0, lineEnd);
+            text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+            while (!line.empty() and (line.back() == '\r' or isBlank(line.back()))) {
+                line.remove_suffix(1);
+            }
+            //blank lines are skipped without counting as malformed
+            if (line.empty()) {
+                continue;
+            }
+
+            std::string_view key;
+            size_t value;
+            if (!parseLine(line, delimiter, key, value)) {
+                piece.malformedLines++;
+                continue;
+            }
+            size_t offset = piece.keyBytes.size();
+            piece.keyBytes.insert(piece.keyBytes.end(), key.begin(), key.end());
+            piece.entries.emplace_back(std::string_view(piece.keyBytes.data() + offset, key.size()), value);
+        }
+        std::stable_sort(piece.entries.begin(), piece.entries.end(), [](const Entry& a, const Entry& b) {
+            return a.first < b.first;
+        });
+    }
+
+    /*
+     *  parseBlock - split text at line ends into one piece per thread and parse the pieces at the same time
+     *
+     *  params
+     *      text - whole lines of the file
+     *      delimiter - separator before the value
+     *      threads - how many pieces to make at most
+     *      pieces - the parsed pieces are added here in file order
+     */
+    void parseBlock(std::string_view text, char delimiter, size_t threads, std::vector<ParsedPiece>& pieces) {
+        std::vector<std::string_view> texts;
+        size_t pieceBytes = text.size() / threads + 1;
+        while (!text.empty()) {
+            size_t lineEnd = text.find('\n', std::min(text.size(), pieceBytes) - 1);
+            size_t end = lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+            texts.push_back(text.substr(0, end));
+            text.remove_prefix(end);
+        }
+
+        size_t first = pieces.size();
+        pieces.resize(first + texts.size());
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < texts.size(); i++) {
+            workers.emplace_back(parsePiece, texts[i], delimiter, std::ref(pieces[first + i]));
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /*
+     *  mergeRuns - merge neighbouring sorted runs in pairs until one is left. Each round merges its pairs on
+     *      separate threads. std::merge takes from the earlier run first on equal keys, so repeated keys stay
+     *      in file order
+     *
+     *  params
+     *      runs - sorted runs in file order
+     *      threads - how many pairs to merge at once
+     *
+     *  returns - the single merged run
+     */
+    std::vector<Entry> mergeRuns(std::vector<std::vector<Entry>> runs, size_t threads) {
+        if (runs.empty()) {
+            return {};
+        }
+        auto byKey = [](const Entry& a, const Entry& b) {
+            return a.first < b.first;
+        };
+        while (runs.size() > 1) {
+            std::vector<std::vector<Entry>> merged((runs.size() + 1) / 2);
+            for (size_t batch = 0; batch < merged.size(); batch += threads) {
+                std::vector<std::thread> workers;
+                for (size_t pair = batch; pair < merged.size() and pair < batch + threads; pair++) {
+                    workers.emplace_back([&runs, &merged, pair, byKey]() {
+                        std::vector<Entry>& left = runs[2 * pair];
+                        if (2 * pair + 1 == runs.size()) {
+                            merged[pair] = std::move(left);
+                            return;
+                        }
+                        std::vector<Entry>& right = runs[2 * pair + 1];
+                        merged[pair].resize(left.size() + right.size());
+                        std::merge(left.begin(), left.end(), right.begin(), right.end(), merged[pair].begin(), byKey);
+                        std::vector<Entry>().swap(left);
+                        std::vector<Entry>().swap(right);
+                    });
+                }
+                for (std::thread& worker : workers) {
+                    worker.join();
+                }
+            }
+            runs.swap(merged);
+        }
+        return std::move(runs.front());
+    }
+
+    /*
+     *  keepLastWrites - drop all but the last entry of each key, entries must be sorted with repeats in file order
+     */
+    void keepLastWrites(std::vector<Entry>& entries) {
+        size_t kept = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i + 1 < entries.size() and entries[i + 1].first == entries[i].first) {
+                continue;
+            }
+            entries[kept++] = entries[i];
+        }
+        entries.resize(kept);
+    }
+}
+
+/*
+ *  importFile - load the dump at path into tree
+ *
+ *  params
+ *      path - text or CSV file with one key and value per line
+ *      tree - tree whose keys are replaced
+ *      options - separator, threads, block size and progress callback
+ *      progress - left holding the final counts if not nullptr
+ *
+ *  returns - false if the file could not be opened or read, the tree is then left as it was
+ */
+bool importFile(const std::string &path, AVLTree &tree, const ImportOptions &options, ImportProgress *progress) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ImportProgress status;
+    file.seekg(0, std::ios::end);
+    status.totalBytes = static_cast<uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    char delimiter = options.delimiter;
+    if (delimiter == 0 and path.size() >= 4 and path.compare(path.size() - 4, 4, ".csv") == 0) {
+        delimiter = ',';
+    }
+    size_t threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t blockBytes = std::max<size_t>(options.blockBytes, 1);
+    auto report = [&](ImportProgress::Stage stage) {
+        status.stage = stage;
+        status.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (options.onProgress) {
+            options.onProgress(status);
+        }
+    };
+
+    //the tail of a block after its last line end is carried over to the front of the next block
+    std::vector<ParsedPiece> pieces;
+    std::vector<char> block;
+    while (true) {
+        size_t carried = block.size();
+        block.resize(carried + blockBytes);
+        file.read(block.data() + carried, static_cast<std::streamsize>(blockBytes));
+        size_t got = static_cast<size_t>(file.gcount());
+        block.resize(carried + got);
+        status.bytesRead += got;
+        bool atEnd = got < blockBytes;
+        if (atEnd and file.bad()) {
+            return false;
+        }
+
+        std::string_view text(block.data(), block.size());
+        size_t lastLine = atEnd ? text.size() : text.rfind('\n');
+        //a line longer than the block keeps growing the block until its end is read
+        if (lastLine == std::string_view::npos) {
+            continue;
+        }
+        size_t parsed = atEnd ? text.size() : lastLine + 1;
+        size_t before = pieces.size();
+        parseBlock(text.substr(0, parsed), delimiter, threads, pieces);
+        for (size_t i = before; i < pieces.size(); i++) {
+            status.records += pieces[i].entries.size();
+            status.malformedLines += pieces[i].malformedLines;
+        }
+        block.erase(block.begin(), block.begin() + static_cast<std::ptrdiff_t>(parsed));
+        report(ImportProgress::Stage::Parse);
+        if (atEnd) {
+            break;
+        }
+    }
+
+    report(ImportProgress::Stage::Merge);
+    std::vector<std::vector<Entry>> runs;
+    runs.reserve(pieces.size());
+    for (ParsedPiece& piece : pieces) {
+        runs.push_back(std::move(piece.entries));
+    }
+    std::vector<Entry> entries = mergeRuns(std::move(runs), threads);
+    keepLastWrites(entries);
+
+    status.keys = entries.size();
+    report(ImportProgress::Stage::Build);
+    tree.assignSorted(entries);
+
+    report(ImportProgress::Stage::Done);
+    if (progress != nullptr) {
+        *progress = status;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+/**
+ * AVLImport.h
+ *
+ * Bulk loads an AVLTree from a text or CSV dump with one "key<delimiter>value" line per key. The file is read in
+ * large blocks and each block is split at line ends into one piece per thread. Every thread copies the keys of its
+ * piece into a byte buffer of that piece's own (no string per line) and sorts them, the sorted pieces are merged
+ * pairwise in parallel, and the merged keys are handed to AVLTree::assignSorted which builds the tree in one
+ * linear pass.
+ */
+
+#ifndef AVLIMPORT_H
+#define AVLIMPORT_H
+#include "AVLTree.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+struct ImportProgress {
+    enum class Stage { Parse, Merge, Build, Done };
+    Stage stage = Stage::Parse;
+    uint64_t bytesRead = 0;
+    uint64_t totalBytes = 0;
+    // lines parsed into a key and value so far
+    size_t records = 0;
+    // lines skipped because they had no delimiter, an empty key or a value that is not a number
+    size_t malformedLines = 0;
+    // distinct keys, known once the Build stage starts
+    size_t keys = 0;
+    // time since the import started
+    double seconds = 0;
+};
+
+struct ImportOptions {
+    // separator between key and value, 0 picks ',' for .csv files and any run of spaces or tabs otherwise. The
+    // value is taken from after the last separator so keys may contain it
+    char delimiter = 0;
+    // parse, sort and merge threads, 0 uses every hardware thread
+    size_t threads = 0;
+    // bytes read and parsed per block
+    size_t blockBytes = size_t{64} << 20;
+    // called after every block and when the import moves to the next stage
+    std::function<void(const ImportProgress&)> onProgress;
+};
+
+// replaces the keys of tree with the keys in the file at path, a key listed more than once keeps its last value.
+// progress, if given, is left holding the final counts. false if the file could not be read
+bool importFile(const std::string& path, AVLTree& tree, const ImportOptions& options = {}, ImportProgress* progress = nullptr);
+
+#endif //AVLIMPORT_H
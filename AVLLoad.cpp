@@ -0,0 +1,85 @@
+/*
+Loads a text or CSV dump into an AVLTree with the parallel importer, printing progress and throughput as it goes.
+
+usage: AVLLoad <dump file> [--threads <n>] [--delimiter <c>] [--block <MiB>]
+
+Each line is a key, a delimiter and a number. CSV files (by extension) use ',', anything else any run of spaces
+or tabs unless --delimiter says otherwise. A key listed more than once keeps its last value.
+ */
+#include "AVLTree.h"
+#include "AVLImport.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+using namespace std;
+
+/*
+ *  stageName - label printed for each import stage
+ */
+const char* stageName(ImportProgress::Stage stage) {
+    switch (stage) {
+        case ImportProgress::Stage::Parse:
+            return "parse";
+        case ImportProgress::Stage::Merge:
+            return "merge";
+        case ImportProgress::Stage::Build:
+            return "build";
+        case ImportProgress::Stage::Done:
+            return "done";
+    }
+    return "";
+}
+
+/*
+ *  printProgress - one status line on stderr, read and parse throughput are measured from the start
+ */
+void printProgress(const ImportProgress& progress) {
+    double mib = static_cast<double>(progress.bytesRead) / (1 << 20);
+    double totalMiB = static_cast<double>(progress.totalBytes) / (1 << 20);
+    cerr << stageName(progress.stage) << ": " << static_cast<size_t>(mib) << " / " << static_cast<size_t>(totalMiB)
+         << " MiB  " << progress.records << " records";
+    if (progress.seconds > 0) {
+        cerr << "  " << static_cast<size_t>(mib / progress.seconds) << " MiB/s  "
+             << static_cast<size_t>(progress.records / progress.seconds) << " records/s";
+    }
+    cerr << "  " << progress.seconds << "s" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " <dump file> [--threads <n>] [--delimiter <c>] [--block <MiB>]" << endl;
+        return 1;
+    }
+
+    ImportOptions options;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--threads") == 0) {
+            options.threads = strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--delimiter") == 0) {
+            options.delimiter = strcmp(argv[i + 1], "\\t") == 0 ? '\t' : argv[i + 1][0];
+        }
+        else if (strcmp(argv[i], "--block") == 0) {
+            options.blockBytes = strtoull(argv[i + 1], nullptr, 10) << 20;
+        }
+    }
+    options.onProgress = printProgress;
+
+    AVLTree tree;
+    ImportProgress result;
+    if (!importFile(argv[1], tree, options, &result)) {
+        cerr << "could not read " << argv[1] << endl;
+        return 1;
+    }
+
+    cout << "keys: " << tree.size() << endl;
+    cout << "records: " << result.records << " (" << result.records - result.keys << " overwritten)" << endl;
+    cout << "malformed lines: " << result.malformedLines << endl;
+    cout << "height: " << (tree.size() == 0 ? 0 : tree.getHeight()) << endl;
+    cout << "seconds: " << result.seconds << endl;
+    if (result.seconds > 0) {
+        cout << "throughput: " << static_cast<size_t>(result.records / result.seconds) << " records/s" << endl;
+    }
+    return 0;
+}
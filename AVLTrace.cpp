@@ -0,0 +1,139 @@
+#include "AVLTrace.h"
+#include "BinaryIO.h"
+
+namespace {
+    const char traceMagic[4] = {'A', 'V', 'L', 'T'};
+    const char traceVersion = 1;
+}
+
+/*
+ *  TraceRecorder constructor - writes the header and starts the trace clock
+ *
+ *      params
+ *          os - stream records are written to
+ */
+TraceRecorder::TraceRecorder(std::ostream &os) : os(os) {
+    this->start = std::chrono::steady_clock::now();
+    this->lastTimestamp = 0;
+    this->records = 0;
+    this->os.write(traceMagic, sizeof(traceMagic));
+    this->os.put(traceVersion);
+}
+
+/*
+ *  record - append one call to the trace
+ *
+ *  params
+ *      op - which call was made
+ *      key - key argument
+ *      value - value argument of insert
+ *      highKey - high key argument of findRange
+ *      ttl - ttl argument of insert with a ttl, a negative ttl is written as 0 since both expire at once
+ */
+void TraceRecorder::record(TraceOp op, const std::string &key, size_t value, const std::string *highKey,
+                           std::chrono::milliseconds ttl) {
+    uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - this->start).count();
+
+    this->os.put(static_cast<char>(op));
+    //timestamps only go up so the delta stays small
+    writeVarint(this->os, timestamp - this->lastTimestamp);
+    writeString(this->os, key);
+    if (op == TraceOp::Insert) {
+        writeVarint(this->os, value);
+    }
+    else if (op == TraceOp::InsertTTL) {
+        writeVarint(this->os, value);
+        writeVarint(this->os, ttl.count() > 0 ? static_cast<uint64_t>(ttl.count()) : 0);
+    }
+    else if (op == TraceOp::FindRange) {
+        writeString(this->os, (highKey != nullptr) ? *highKey : std::string());
+    }
+
+    this->lastTimestamp = timestamp;
+    this->records++;
+}
+
+/*
+ *  recordCount - number of records written so far
+ */
+size_t TraceRecorder::recordCount() const {
+    return this->records;
+}
+
+/*
+ *  TraceReader constructor - reads the header
+ *
+ *      params
+ *          is - stream holding a trace
+ */
+TraceReader::TraceReader(std::istream &is) : is(is) {
+    this->lastTimestamp = 0;
+    char header[sizeof(traceMagic) + 1];
+    this->is.read(header, sizeof(header));
+    this->valid = this->is.gcount() == sizeof(header) and
+                  std::char_traits<char>::compare(header, traceMagic, sizeof(traceMagic)) == 0 and
+                  header[sizeof(traceMagic)] == traceVersion;
+}
+
+/*
+ *  good - true if the stream started with a trace header this reader understands
+ */
+bool TraceReader::good() const {
+    return this->valid;
+}
+
+/*
+ *  next - read the next record
+ *
+ *  params
+ *      record - filled in with the record
+ *
+ *  returns - false at the end of the trace or if the record is cut off
+ */
+bool TraceReader::next(TraceRecord &record) {
+    if (!this->valid) {
+        return false;
+    }
+    int op = this->is.get();
+    if (op == std::char_traits<char>::eof()) {
+        return false;
+    }
+
+    uint64_t delta;
+    if (!readVarint(this->is, delta) or !readString(this->is, record.key)) {
+        return false;
+    }
+    record.op = static_cast<TraceOp>(op);
+    record.timestamp = this->lastTimestamp + delta;
+    record.value = 0;
+    record.highKey.clear();
+    record.ttl = std::chrono::milliseconds(0);
+
+    if (record.op == TraceOp::Insert or record.op == TraceOp::InsertTTL) {
+        uint64_t value;
+        if (!readVarint(this->is, value)) {
+            return false;
+        }
+        record.value = value;
+        if (record.op == TraceOp::InsertTTL) {
+            uint64_t ttl;
+            if (!readVarint(this->is, ttl)) {
+                return false;
+            }
+            record.ttl = std::chrono::milliseconds(ttl);
+        }
+    }
+    else if (record.op == TraceOp::FindRange) {
+        if (!readString(this->is, record.highKey)) {
+            return false;
+        }
+    }
+    else if (record.op != TraceOp::Get and record.op != TraceOp::Remove and record.op != TraceOp::Index) {
+        //unknown op, the rest of the trace can not be parsed
+        return false;
+    }
+
+    this->lastTimestamp = record.timestamp;
+    return true;
+}
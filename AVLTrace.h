@@ -0,0 +1,69 @@
+/**
+ * AVLTrace.h
+ *
+ * Binary trace of the operations called on an AVLTree. A trace is the magic "AVLT", a version byte and then one
+ * record per call: op byte, varint nanoseconds since the previous record, the key and then the ops argument
+ * (the value for insert, the value and a varint ttl in milliseconds for insert with a ttl, the high key for
+ * findRange, nothing for the rest).
+ */
+
+#ifndef AVLTRACE_H
+#define AVLTRACE_H
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+enum class TraceOp : uint8_t {
+    Insert = 1,
+    Get = 2,
+    Remove = 3,
+    FindRange = 4,
+    Index = 5, // operator[]
+    InsertTTL = 6, // insert with a ttl
+};
+
+struct TraceRecord {
+    TraceOp op;
+    // nanoseconds since the trace started
+    uint64_t timestamp;
+    std::string key;
+    // high key of findRange
+    std::string highKey;
+    // value of insert
+    size_t value;
+    // ttl of insert with a ttl
+    std::chrono::milliseconds ttl;
+};
+
+class TraceRecorder {
+public:
+    // writes the trace header to os, os must outlive the recorder
+    explicit TraceRecorder(std::ostream& os);
+    void record(TraceOp op, const std::string& key, size_t value = 0, const std::string* highKey = nullptr,
+                std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+    size_t recordCount() const;
+
+private:
+    std::ostream& os;
+    std::chrono::steady_clock::time_point start;
+    uint64_t lastTimestamp;
+    size_t records;
+};
+
+class TraceReader {
+public:
+    // reads and checks the trace header, good() is false if it is not a trace
+    explicit TraceReader(std::istream& is);
+    bool good() const;
+    // reads the next record, false at the end of the trace
+    bool next(TraceRecord& record);
+
+private:
+    std::istream& is;
+    uint64_t lastTimestamp;
+    bool valid;
+};
+
+#endif //AVLTRACE_H
@@ -0,0 +1,184 @@
+/*
+Replays a trace recorded with AVLTree::setTraceRecorder against a tree and reports throughput
+and the latency of every call.
+
+usage: AVLTraceReplay <trace file> [--engine avl|wavl|disk] [--pace max|real] [--memory <MiB>]
+
+The disk engine keeps its pages in <trace file>.pages, which is removed afterwards, and caches at most
+--memory MiB of them (64 by default).
+ */
+#include "AVLTree.h"
+#include "AVLTrace.h"
+#include "DiskAVLTree.h"
+#include "LatencyHistogram.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+struct ReplayResult {
+    size_t operations = 0;
+    double seconds = 0;
+    LatencySnapshot latencies;
+};
+
+/*
+ *  replay - run every record against tree, in real mode each call waits until its recorded time
+ */
+template <typename Tree>
+ReplayResult replay(Tree& tree, const vector<TraceRecord>& records, bool realPace) {
+    ReplayResult result;
+    LatencyHistogram histogram;
+    auto start = chrono::steady_clock::now();
+
+    for (const TraceRecord& record : records) {
+        if (realPace) {
+            this_thread::sleep_until(start + chrono::nanoseconds(record.timestamp));
+        }
+
+        auto before = chrono::steady_clock::now();
+        switch (record.op) {
+            case TraceOp::Insert:
+                tree.insert(record.key, record.value);
+                break;
+            case TraceOp::InsertTTL:
+                //trees without expiry keep the key for good
+                if constexpr (requires { tree.insert(record.key, record.value, record.ttl); }) {
+                    tree.insert(record.key, record.value, record.ttl);
+                }
+                else {
+                    tree.insert(record.key, record.value);
+                }
+                break;
+            case TraceOp::Get:
+                tree.get(record.key);
+                break;
+            case TraceOp::Remove:
+                tree.remove(record.key);
+                break;
+            case TraceOp::FindRange:
+                tree.findRange(record.key, record.highKey);
+                break;
+            case TraceOp::Index:
+                //the disk tree throws for keys too long to store, insert skips those the same way
+                try {
+                    tree[record.key]++;
+                }
+                catch (const length_error&) {
+                }
+                break;
+        }
+        auto after = chrono::steady_clock::now();
+
+        histogram.record(chrono::duration_cast<chrono::nanoseconds>(after - before).count());
+        result.operations++;
+    }
+
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.latencies = histogram.snapshot();
+    return result;
+}
+
+/*
+ *  printResult - throughput, percentiles and the non empty histogram buckets
+ */
+void printResult(const ReplayResult& result) {
+    cout << "operations: " << result.operations << endl;
+    cout << "seconds: " << result.seconds << endl;
+    if (result.seconds > 0) {
+        cout << "throughput: " << static_cast<size_t>(result.operations / result.seconds) << " ops/s" << endl;
+    }
+    const LatencySnapshot& latencies = result.latencies;
+    cout << "p50: " << latencies.percentile(0.50) << "ns  p99: " << latencies.percentile(0.99)
+         << "ns  p999: " << latencies.percentile(0.999) << "ns  max: " << latencies.maxNanoseconds << "ns" << endl;
+    cout << endl << "latency histogram" << endl;
+    for (size_t bucket = 0; bucket < latencies.counts.size(); bucket++) {
+        if (latencies.counts[bucket] != 0) {
+            uint64_t low = bucket == 0 ? 0 : LatencyHistogram::bucketUpperBound(bucket - 1) + 1;
+            cout << "[" << low << "ns, " << LatencyHistogram::bucketUpperBound(bucket) << "ns] "
+                 << latencies.counts[bucket] << endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " <trace file> [--engine avl|wavl|disk] [--pace max|real] [--memory <MiB>]" << endl;
+        return 1;
+    }
+
+    string engine = "avl";
+    bool realPace = false;
+    size_t memoryMiB = 64;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--engine") == 0) {
+            engine = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--pace") == 0) {
+            realPace = strcmp(argv[i + 1], "real") == 0;
+        }
+        else if (strcmp(argv[i], "--memory") == 0) {
+            memoryMiB = strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    ifstream file(argv[1], ios::binary);
+    TraceReader reader(file);
+    if (!reader.good()) {
+        cerr << argv[1] << " is not a trace file" << endl;
+        return 1;
+    }
+
+    //load the whole trace first so reading the file is not timed
+    vector<TraceRecord> records;
+    TraceRecord record;
+    while (reader.next(record)) {
+        records.push_back(record);
+    }
+
+    ReplayResult result;
+    if (engine == "avl") {
+        AVLTree tree;
+        result = replay(tree, records, realPace);
+    }
+    else if (engine == "wavl") {
+        AVLTree tree(AVLTree::BalancePolicy::WAVL);
+        result = replay(tree, records, realPace);
+    }
+    else if (engine == "disk") {
+        //start from an empty page file every run
+        string pagePath = string(argv[1]) + ".pages";
+        std::remove(pagePath.c_str());
+        {
+            DiskAVLTree tree(pagePath, memoryMiB << 20);
+            if (!tree.good()) {
+                cerr << "could not create " << pagePath << endl;
+                return 1;
+            }
+            try {
+                result = replay(tree, records, realPace);
+            }
+            catch (const runtime_error& error) {
+                cerr << error.what() << endl;
+                return 1;
+            }
+            cout << "page reads: " << tree.pageReads() << "  page writes: " << tree.pageWrites() << endl;
+        }
+        std::remove(pagePath.c_str());
+    }
+    else {
+        cerr << "unknown engine " << engine << endl;
+        return 1;
+    }
+
+    cout << "engine: " << engine << endl;
+    printResult(result);
+    return 0;
+}
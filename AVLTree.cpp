@@ -1,6 +1,27 @@
 #include "AVLTree.h"
+#include "AVLTrace.h"
+#include "BinaryIO.h"
 
 #include <string>
+#include <cstdint>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <new>
+#include <cstdlib>
+
+//hint the cpu to start loading a node before it is needed
+#if defined(__GNUC__) || defined(__clang__)
+#define AVL_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define AVL_PREFETCH(address)
+#endif
+
+namespace {
+    const char checkpointMagic[4] = {'A', 'V', 'L', 'C'};
+    const char checkpointVersion = 1;
+}
 
 /*
  * AvlNode constructor - sets parent, key and value to paramater values
@@ -12,12 +33,20 @@
  *
  */
 AVLTree::AVLNode::AVLNode(std::string key, size_t value, AVLNode* parent) {
-    this->key = key;
+    this->key = std::move(key);
     this->value = value;
     this->height = 0;
+    this->aggregate = value;
     this->parent = parent;
     this->left = nullptr;
     this->right = nullptr;
+    this->usePrev = nullptr;
+    this->useNext = nullptr;
+    this->referenced = false;
+    this->dirty = false;
+    this->subtreeDirty = false;
+    this->inArena = false;
+    this->expiresAt = noExpiry;
 }
 
 /*
@@ -32,9 +61,17 @@ AVLTree::AVLNode::AVLNode(AVLNode &other, AVLNode *parent) {
     this->key = other.key;
     this->value = other.value;
     this->height = other.height;
+    this->aggregate = other.aggregate;
     this->parent = parent;
     this->left = nullptr;
     this->right = nullptr;
+    this->usePrev = nullptr;
+    this->useNext = nullptr;
+    this->referenced = false;
+    this->dirty = false;
+    this->subtreeDirty = false;
+    this->inArena = false;
+    this->expiresAt = other.expiresAt;
 }
 
 /*
@@ -112,9 +149,54 @@ size_t AVLTree::AVLNode::getHeight() const {
 /*
  *  default AVLTree constructor - sets treeSize to zero and root to nullptr
  */
-AVLTree::AVLTree() {
+AVLTree::AVLTree() : AVLTree(BalancePolicy::AVL) {
+}
+
+/*
+ *  AVLTree constructor - empty tree balanced by the given policy
+ *
+ *      params
+ *          policy - AVL or WAVL balancing
+ */
+AVLTree::AVLTree(BalancePolicy policy) {
     this->root = nullptr;
     this->treeSize = 0;
+    this->treeBytes = 0;
+    this->maxEntries = 0;
+    this->maxBytes = 0;
+    this->evictionPolicy = EvictionPolicy::LeastRecentlyUsed;
+    this->recencyHead = nullptr;
+    this->recencyTail = nullptr;
+    this->clockHand = nullptr;
+    this->traceRecorder = nullptr;
+    this->balancePolicy = policy;
+    this->rotationCount = 0;
+    this->removedParent = nullptr;
+    this->removedChild = nullptr;
+    this->backgroundReclaim = false;
+    this->writeBufferLimit = 0;
+    this->writeBufferMaxAge = std::chrono::milliseconds(0);
+    this->structureVersion = 0;
+    this->checkpointing = false;
+    this->checkpointSequence = 0;
+    this->latencyHistograms = nullptr;
+    this->compactionNext = 0;
+    this->compactionActive = false;
+    this->compactionStale = false;
+    this->compactionGeneration = 0;
+    this->compactionBlock = nullptr;
+    this->compactionBlockUsed = 0;
+    this->ttlKeys = 0;
+    this->changeLogLimit = 0;
+    this->changeCoalesce = false;
+    this->changeSequenceNumber = 0;
+    this->changesDroppedThrough = 0;
+    this->supersededChanges = 0;
+    this->appliedSequence = 0;
+    this->filter = nullptr;
+    this->filterFalsePositiveRate = 0;
+    this->filterRejected = 0;
+    this->filterFalsePositives = 0;
 }
 
 /*
@@ -133,11 +215,12 @@ size_t AVLTree::getHeight() const {
  *      returns treeSize a variable used to know how many keyValue pairs are in the tree
  */
 size_t AVLTree::size() const {
-    return this->treeSize;
+    return this->treeSize + this->writeBuffer.size();
 }
 
 /*
- *  findRange - returns a vector containing all values whose key falls within the range lowKey < key < highKey
+ *  findRange - returns a vector containing all values whose key falls within the range lowKey <= key <= highKey,
+ *      in key order
  *
  *  params
  *      lowKey - reference to low key value
@@ -147,652 +230,3361 @@ size_t AVLTree::size() const {
  *      vector list of all values in key range
  */
 vector<std::string> AVLTree::findRange(const std::string &lowKey, const std::string &highKey) const {
-    AVLNode* node = this->root;
+    LatencyTimer timer(latencyHistogram(TimedOp::FindRange));
+    if (this->traceRecorder != nullptr) {
+        this->traceRecorder->record(TraceOp::FindRange, lowKey, 0, &highKey);
+    }
     vector<std::string> returnVector;
-    //Recursive function used to add all keys to return vector
-    rangeHelper(lowKey, highKey, returnVector, this->root);
+    //Recursive function used to add all keys to return vector, buffered keys are merged in as it goes
+    size_t bufferIndex = bufferPosition(lowKey);
+    rangeHelper(lowKey, highKey, returnVector, this->root, bufferIndex);
+
+    //buffered keys past the last node in range
+    for (; bufferIndex < this->writeBuffer.size() and this->writeBuffer[bufferIndex].key <= highKey; bufferIndex++) {
+        returnVector.push_back(std::to_string(this->writeBuffer[bufferIndex].value));
+    }
 
     return returnVector;
 }
 
 /*
- * rangeHelper - recursive function that adds all nodes with key values in range into a vector
+ * rangeHelper - recursive in order walk adding the value of every node with lowKey <= key <= highKey. Buffered keys
+ *      that come before a node are added ahead of it so the values stay in key order
  *
  *  params
  *      lowKey - low range
  *      highKey - high range
  *      returnVector - vector values are being added to
  *      curNode - the current node being looked at in the list
- *
- *   returns false if node is not in range
- *
+ *      bufferIndex - next buffered key to add, moved past the ones added
  */
-bool AVLTree::rangeHelper(const std::string &lowKey, const std::string &highKey, vector<std::string>& returnVector, AVLTree::AVLNode* curNode) const {
+void AVLTree::rangeHelper(const std::string &lowKey, const std::string &highKey, vector<std::string>& returnVector, AVLTree::AVLNode* curNode, size_t& bufferIndex) const {
     //bottom of tree
     if (curNode == nullptr) {
-      return false;
+        return;
     }
 
-    //root case
-    if (curNode == this->root) {
-        //if root is not in range then can end early
-        if ((curNode->key >= lowKey) or (curNode->key <= highKey)){
-            returnVector.push_back(std::to_string(curNode->value));
-        }
-        else {
-            return false;
-        }
+    //left side only holds keys in range if this key is above lowKey
+    if (curNode->key > lowKey) {
+        rangeHelper(lowKey, highKey, returnVector, curNode->left, bufferIndex);
     }
 
-    //Go through left side of node
-    if (curNode->key >= lowKey) {
-        if (rangeHelper(lowKey, highKey, returnVector, curNode->left)) {
-            returnVector.push_back(std::to_string(curNode->left->value));
+    if (curNode->key >= lowKey and curNode->key <= highKey) {
+        for (; bufferIndex < this->writeBuffer.size() and this->writeBuffer[bufferIndex].key < curNode->key; bufferIndex++) {
+            returnVector.push_back(std::to_string(this->writeBuffer[bufferIndex].value));
+        }
+        if (!isExpired(curNode)) {
+            returnVector.push_back(std::to_string(curNode->value));
         }
     }
 
-    //Go through right side of node
-    if (curNode->key <= highKey) {
-        if (rangeHelper(lowKey, highKey, returnVector, curNode->right)) {
-            returnVector.push_back(std::to_string(curNode->right->value));
-        }
+    //right side only holds keys in range if this key is below highKey
+    if (curNode->key < highKey) {
+        rangeHelper(lowKey, highKey, returnVector, curNode->right, bufferIndex);
     }
+}
 
+/*
+ *  Aggregate::sum - aggregate adding values together, identity 0
+ */
+AVLTree::Aggregate AVLTree::Aggregate::sum() {
+    return Aggregate{[](size_t a, size_t b) { return a + b; }, 0};
+}
 
-    //leftkey less than lowkey end
-    if (curNode->key < lowKey) {
-        return false;
-    }
-    //rightkey greater than right key end
-    if (curNode->key > highKey) {
-        return false;
-    }
+/*
+ *  Aggregate::min - aggregate keeping the smallest value, identity is the largest size_t
+ */
+AVLTree::Aggregate AVLTree::Aggregate::min() {
+    return Aggregate{[](size_t a, size_t b) { return a < b ? a : b; }, SIZE_MAX};
+}
 
-    //continue
-    return true;
+/*
+ *  Aggregate::max - aggregate keeping the largest value, identity 0
+ */
+AVLTree::Aggregate AVLTree::Aggregate::max() {
+    return Aggregate{[](size_t a, size_t b) { return a > b ? a : b; }, 0};
 }
 
 /*
- * operator[] - allows access to value given key value
+ *  setAggregate - set the function combined over node values. Every node stores the aggregate of its subtree
+ *      which is kept up to date through insert, remove and rotations. Values written through the reference
+ *      returned by operator[] are not seen until that node is next updated.
  *
- * returns - size_t reference so that the value can be modified
+ *  params
+ *      aggregate - associative combine function and its identity, combine may be empty to turn aggregates off
  */
-size_t& AVLTree::operator[](const std::string &key) {
-    AVLNode* node = getNodePlace(key, this->root);
-    if (node != nullptr) {
-        return node->value;
+void AVLTree::setAggregate(const Aggregate &aggregate) {
+    this->aggregateFunction = aggregate;
+    //existing nodes need their aggregates computed
+    aggregateHelper(this->root);
+}
+
+/*
+ *  aggregateHelper - recursive post order walk recomputing every nodes aggregate
+ *
+ *  params
+ *      curNode - top of subtree to recompute
+ */
+void AVLTree::aggregateHelper(AVLNode *curNode) {
+    if (curNode == nullptr) {
+        return;
+    }
+    aggregateHelper(curNode->left);
+    aggregateHelper(curNode->right);
+    updateNode(curNode);
+}
+
+/*
+ *  subtreeAggregate - aggregate stored in node or the identity when there is no node
+ */
+size_t AVLTree::subtreeAggregate(AVLNode *node) const {
+    if (node == nullptr) {
+        return this->aggregateFunction.identity;
     }
+    return node->aggregate;
 }
 
 /*
- * keys - returns all values from tree into a vector
+ *  aggregateRange - combine the values of all keys in lowKey <= key <= highKey in key order, including keys still
+ *      in the write buffer
  *
- *  returns - vector containing all values
+ *  params
+ *      lowKey - low end of range
+ *      highKey - high end of range
  *
+ *  returns - combined value, the identity if the range is empty or no aggregate is set
  */
-std::vector<std::string> AVLTree::keys() const {
-    std::vector<std::string> returnVector;
-    //recursive function that navigates tree
-    keysHelper(this->root, returnVector);
-    return returnVector;
+size_t AVLTree::aggregateRange(const std::string &lowKey, const std::string &highKey) const {
+    const auto& combine = this->aggregateFunction.combine;
+    size_t position = bufferPosition(lowKey);
+    if (!combine or position >= this->writeBuffer.size() or this->writeBuffer[position].key > highKey) {
+        return treeAggregateRange(lowKey, highKey);
+    }
+
+    //buffered keys are not in the tree so the tree ranges between them can share their ends and stay in key order
+    size_t result = this->aggregateFunction.identity;
+    const std::string* from = &lowKey;
+    for (; position < this->writeBuffer.size() and this->writeBuffer[position].key <= highKey; position++) {
+        const auto& entry = this->writeBuffer[position];
+        result = combine(combine(result, treeAggregateRange(*from, entry.key)), entry.value);
+        from = &entry.key;
+    }
+    return combine(result, treeAggregateRange(*from, highKey));
 }
 
 /*
- *  keysHelper - recursive helper function used to recursivley go through list and add all node values to vector
+ *  treeAggregateRange - aggregateRange over the nodes in the tree. Only the two paths bounding the range are walked,
+ *      whole subtrees in between use their stored aggregate
  *
  *  params
- *      curNode - the current node being looked at in the tree
- *      returnVector - vector that is getting added to
- *
- *  returns - boolean false if done true if needing to continue
+ *      lowKey - low end of range
+ *      highKey - high end of range
  *
+ *  returns - combined value, the identity if the range is empty or no aggregate is set
  */
-bool AVLTree::keysHelper(AVLNode* curNode, vector<std::string>& returnVector) const {
-    //bottom of tree
-    if (curNode == nullptr) {
-        return false;
+size_t AVLTree::treeAggregateRange(const std::string &lowKey, const std::string &highKey) const {
+    const auto& combine = this->aggregateFunction.combine;
+    size_t identity = this->aggregateFunction.identity;
+    if (!combine or lowKey > highKey) {
+        return identity;
     }
 
-    //root case
-    if (curNode == this->root) {
-        returnVector.push_back(std::to_string(curNode->value));
+    //find the highest node inside the range, the range splits there
+    AVLNode* split = this->root;
+    while (split != nullptr and (split->key < lowKey or split->key > highKey)) {
+        split = (split->key < lowKey) ? split->right : split->left;
+    }
+    if (split == nullptr) {
+        return identity;
     }
 
-    //add all right members of node
-    if (curNode->right != nullptr) {
-        if (keysHelper(curNode->right, returnVector)) {
-            returnVector.push_back(std::to_string(curNode->right->value));
+    //left path: every node >= lowKey adds itself and its right subtree in front of what was found so far
+    size_t leftResult = identity;
+    AVLNode* node = split->left;
+    while (node != nullptr) {
+        if (node->key >= lowKey) {
+            leftResult = combine(combine(node->value, subtreeAggregate(node->right)), leftResult);
+            node = node->left;
+        }
+        else {
+            node = node->right;
         }
     }
 
-    //add all left members of node
-    if (curNode->right != nullptr) {
-        if (keysHelper(curNode->left, returnVector)) {
-            returnVector.push_back(std::to_string(curNode->left->value));
+    //right path: every node <= highKey adds its left subtree and itself after what was found so far
+    size_t rightResult = identity;
+    node = split->right;
+    while (node != nullptr) {
+        if (node->key <= highKey) {
+            rightResult = combine(rightResult, combine(subtreeAggregate(node->left), node->value));
+            node = node->right;
+        }
+        else {
+            node = node->left;
         }
     }
 
-    //continue
-    return true;
+    return combine(combine(leftResult, split->value), rightResult);
 }
 
 /*
- *  removeNode - function containing logic needed when deleting nodes from tree. Need to check children amount and decide
- *      on delete logic from there.
+ *  setCapacity - limit how much the tree holds, once over either limit keys are evicted by policy until it fits.
+ *      LRU and CLOCK keep every node on an intrusive recency list, smallest and largest key evict from the ends of
+ *      the tree. Each eviction is a normal O(log n) remove
  *
  *  params
- *      current - the current node being looked at in the tree
- *
- *  returns - boolean false if not deleted true if it is deleted
- *
+ *      maxEntries - most keys the tree may hold, 0 for no limit
+ *      maxBytes - most bytes of nodes and keys the tree may hold, 0 for no limit
+ *      policy - how the key to evict is chosen
  */
-bool AVLTree::removeNode(AVLNode*& current){
-    if (!current) {
-        return false;
-    }
+void AVLTree::setCapacity(size_t maxEntries, size_t maxBytes, EvictionPolicy policy) {
+    this->maxEntries = maxEntries;
+    this->maxBytes = maxBytes;
+    this->evictionPolicy = policy;
+    rebuildRecencyList();
+    enforceCapacity(nullptr);
+}
 
-    AVLNode* toDelete = current;
-    auto nChildren = current->numChildren();
+/*
+ *  setTraceRecorder - start or stop recording calls made on the tree
+ *
+ *  params
+ *      recorder - recorder each call is written to, nullptr to stop recording
+ */
+void AVLTree::setTraceRecorder(TraceRecorder *recorder) {
+    this->traceRecorder = recorder;
+}
 
-    //If bottom node just delete it
-    if (current->isLeaf()) {
-        // case 1 we can delete the node
-        current = nullptr;
-    } else if (nChildren == 1) {
-        // case 2 - replace current with its only child
-        if (current->right) {
-            current->right->parent = current->parent;
-            current = current->right;
-        } else {
-            current->left->parent = current->parent;
-            current = current->left;
-        }
-    } else {
-        // case 3 - we have two children,
-        // get smallest key in right subtree by
-        // getting right child and go left until left is null
-        AVLNode* smallestInRight = current->right;
-        // I could check if smallestInRight is null,
-        // but it shouldn't be since the node has two children
-        while (smallestInRight->left) {
-            smallestInRight = smallestInRight->left;
-        }
-        std::string newKey = smallestInRight->key;
-        int newValue = smallestInRight->value;
-        remove(root, smallestInRight->key); // delete this one
-
-        current->key = newKey;
-        current->value = newValue;
-
-        current->height = current->getHeight();
-        balanceNode(current);
+/*
+ *  bytes - returns the memory used by the nodes and the characters of their keys
+ */
+size_t AVLTree::bytes() const {
+    return this->treeBytes;
+}
 
-        return true; // we already deleted the one we needed to so return
-    }
-    delete toDelete;
+/*
+ *  nodeBytes - memory counted against maxBytes for one node
+ */
+size_t AVLTree::nodeBytes(const AVLNode *node) {
+    return sizeof(AVLNode) + node->key.size();
+}
 
-    return true;
+/*
+ *  usesRecencyList - true when the tree has a limit and the policy needs to know the order nodes were used in
+ */
+bool AVLTree::usesRecencyList() const {
+    return (this->maxEntries != 0 or this->maxBytes != 0) and
+           (this->evictionPolicy == EvictionPolicy::LeastRecentlyUsed or this->evictionPolicy == EvictionPolicy::Clock);
 }
 
 /*
- *  remove - recursive helper function used to recursivley go through list and find the node to remove
+ *  linkNode - count a newly created node and put it on the recency list
  *
  *  params
- *      current - the current node being looked at in the tree
- *      key  - key being searched for to remove
- *
- *  returns - boolean true if done false if needing to continue
+ *      node - node just added to the tree
  */
-bool AVLTree::remove(AVLNode *&current, std::string key) {
-    if (current->key == key) {
-        //Remove node from list and return out of recursion
-        removeNode(current);
-        return true;
-    }
-    else if (current->key < key) {
-        //Balancing needs checked if a node was removed
-        if (remove(current->right, key)) {
-            balanceNode(current);
+void AVLTree::linkNode(AVLNode *node) {
+    this->structureVersion++;
+    this->treeSize++;
+    this->treeBytes += nodeBytes(node);
+    if (usesRecencyList()) {
+        //new nodes go in front for LRU, CLOCK puts them just behind the hand so they get a full sweep
+        if (this->evictionPolicy == EvictionPolicy::LeastRecentlyUsed) {
+            pushRecencyFront(node);
+        }
+        else {
+            pushBehindHand(node);
         }
     }
-    else if (current->key > key) {
-        //Balancing needs checked if a node was removed
-        if (remove(current->left, key)) {
-            balanceNode(current);
+    markDirty(node);
+    recordChange(ChangeOp::Insert, node->key, node->value);
+    if (this->filter != nullptr) {
+        this->filter->add(node->key);
+        if (this->filter->keys() > this->filter->capacity()) {
+            rebuildFilter(this->filter->capacity() * 2);
         }
-
     }
-    return false;
 }
 
 /*
- *  remove - remove base function takes a key and uses recursive helper function to find and remove node
+ *  unlinkNode - take a node that is about to be deleted out of the counts and the recency list
  *
  *  params
- *      key  - key being searched for to remove
- *
- *  returns - boolean true if done false if failed
+ *      node - node leaving the tree
  */
-bool AVLTree::remove(const std::string &key) {
-    if (remove(this->root, key)) {
-        return true;
-    } else {
-        return false;
+void AVLTree::unlinkNode(AVLNode *node) {
+    this->structureVersion++;
+    this->treeSize--;
+    this->treeBytes -= nodeBytes(node);
+    if (usesRecencyList()) {
+        removeFromRecency(node);
+    }
+    if (this->checkpointing) {
+        this->removedKeys.push_back(node->key);
+    }
+    if (this->compactionActive) {
+        this->compactionStale = true;
+    }
+    if (node->expiresAt != noExpiry) {
+        this->ttlKeys--;
+    }
+    recordChange(ChangeOp::Remove, node->key, 0);
+    if (this->filter != nullptr) {
+        this->filter->remove(node->key);
     }
 }
 
 /*
- *  insert - Insert node based off key and value data. If already in list fail to add
+ *  touchNode - mark node as just used. LRU moves it to the front of the list, CLOCK sets its reference bit.
+ *      Reads call this too so with either policy they write to the tree
  *
  *  params
- *      key  - key being used to insert
- *      value - the size_t value to store in the node
- *
- *  returns - boolean true if done false if failed
+ *      node - node that was read or written
  */
-bool AVLTree::insert(const std::string& key, size_t value){
-    //Key is in tree already
-    if (getNodePlace(key, this->root) != nullptr) {
-        return false;
+void AVLTree::touchNode(AVLNode *node) const {
+    if (!usesRecencyList()) {
+        return;
     }
+    if (this->evictionPolicy == EvictionPolicy::Clock) {
+        node->referenced = true;
+    }
+    else if (this->recencyHead != node) {
+        removeFromRecency(node);
+        pushRecencyFront(node);
+    }
+}
 
-    //Find where the node should be inserted. Recusivley looks for lowest level
-    if (insertNode(key, value, this->root)) {
-        //If succesful be sure to increase treeSize
-        treeSize++;
-        return true;
+/*
+ *  pushRecencyFront - put node at the head of the recency list
+ */
+void AVLTree::pushRecencyFront(AVLNode *node) const {
+    node->usePrev = nullptr;
+    node->useNext = this->recencyHead;
+    if (this->recencyHead != nullptr) {
+        this->recencyHead->usePrev = node;
+    }
+    else {
+        this->recencyTail = node;
     }
+    this->recencyHead = node;
 }
 
 /*
- *  contains - look to see if node is in tree already
- *
- *  params
- *      key  - key being searched for
- *
- *  returns - boolean true if done false if failed
+ *  pushRecencyBack - put node at the tail of the recency list
  */
-bool AVLTree::contains(const std::string &key) const {
-    if (getNodePlace(key, this->root) != nullptr) {
-        return true;
+void AVLTree::pushRecencyBack(AVLNode *node) const {
+    node->useNext = nullptr;
+    node->usePrev = this->recencyTail;
+    if (this->recencyTail != nullptr) {
+        this->recencyTail->useNext = node;
     }
     else {
-        return false;
+        this->recencyHead = node;
     }
+    this->recencyTail = node;
 }
 
 /*
- *  get - look to see if node is in tree and if it is return value otherwise return nullopt
- *
- *  params
- *      key  - key being searched for
- *
- *  returns - optional<size_t> value of node if present otherwise null opt
+ *  pushBehindHand - put node where the CLOCK hand will reach it last, just before the hand or at the tail when
+ *      the hand is about to wrap around to the head
  */
-std::optional<size_t> AVLTree::get(const std::string& key) const{
-    AVLNode *node = getNodePlace(key, this->root);
+void AVLTree::pushBehindHand(AVLNode *node) const {
+    if (this->clockHand == nullptr) {
+        pushRecencyBack(node);
+        return;
+    }
+    node->useNext = this->clockHand;
+    node->usePrev = this->clockHand->usePrev;
+    if (node->usePrev != nullptr) {
+        node->usePrev->useNext = node;
+    }
+    else {
+        this->recencyHead = node;
+    }
+    this->clockHand->usePrev = node;
+}
 
-    //if node is nullptr then it is not in tree
-    if (node != nullptr) {
-        return node->value;
+/*
+ *  removeFromRecency - unlink node from the recency list, moving the CLOCK hand past it if needed
+ */
+void AVLTree::removeFromRecency(AVLNode *node) const {
+    if (this->clockHand == node) {
+        this->clockHand = node->useNext;
+    }
+    if (node->usePrev != nullptr) {
+        node->usePrev->useNext = node->useNext;
     }
     else {
-        return nullopt;
+        this->recencyHead = node->useNext;
+    }
+    if (node->useNext != nullptr) {
+        node->useNext->usePrev = node->usePrev;
+    }
+    else {
+        this->recencyTail = node->usePrev;
     }
+    node->usePrev = nullptr;
+    node->useNext = nullptr;
 }
 
 /*
- *  getNodePlace - recursive helper function used to recursivley go through list and find a node
+ *  rebuildRecencyList - start the recency list over with every node in key order, or empty it when the policy
+ *      does not need one
+ */
+void AVLTree::rebuildRecencyList() {
+    this->recencyHead = nullptr;
+    this->recencyTail = nullptr;
+    this->clockHand = nullptr;
+    recencyHelper(this->root);
+}
+
+/*
+ *  recencyHelper - recursive in order walk putting each node at the back of the recency list
  *
  *  params
- *      key  - key being searched for
- *      curNode - the node currently being used
- *
- *  returns - the pointer to the node found
+ *      curNode - top of subtree to add
  */
-AVLTree::AVLNode* AVLTree::getNodePlace(const std::string& key, AVLTree::AVLNode* curNode) const{
-    //Found bottom of list node is not present
+void AVLTree::recencyHelper(AVLNode *curNode) {
     if (curNode == nullptr) {
-        return curNode;
-    }
-    //Found node return out
-    else if (curNode->key == key) {
-        return curNode;
-    }
-    //Can still continue search through right node
-    else if (curNode->key < key) {
-        return getNodePlace(key, curNode->right);
+        return;
     }
-    //Can still continue search through left node
-    else {
-        return getNodePlace(key, curNode->left);
+    recencyHelper(curNode->left);
+    curNode->usePrev = nullptr;
+    curNode->useNext = nullptr;
+    curNode->referenced = false;
+    if (usesRecencyList()) {
+        pushRecencyBack(curNode);
     }
+    recencyHelper(curNode->right);
 }
 
 /*
- *  insertNode - helper function used to find proper spot to insert node. Balance is checked for and done if needed after
+ *  chooseVictim - pick the next node to evict according to the policy
  *
  *  params
- *      key  - key to insert
- *      value  - value to insert
- *      curNode  - current node being accessed
+ *      keep - node that must not be picked, may be nullptr
  *
- *  returns - boolean true if done false if not done
+ *  returns - node to evict or nullptr if there is nothing but keep
  */
-bool AVLTree::insertNode(const std::string& key, size_t value, AVLTree::AVLNode* curNode) {
-    //Bottom of tree insert
-    if (curNode == nullptr) {
-        curNode = new AVLNode(key, value, nullptr);
+AVLTree::AVLNode* AVLTree::chooseVictim(AVLNode *keep) {
+    AVLNode* victim = nullptr;
 
-        //Node is root
-        if (this->root == nullptr) {
-            this->root = curNode;
+    if (this->evictionPolicy == EvictionPolicy::LeastRecentlyUsed) {
+        victim = this->recencyTail;
+        if (victim == keep and victim != nullptr) {
+            victim = victim->usePrev;
         }
-
-        return true;
     }
-
-    //Go down right side of node to find where to insert
-    if (curNode->key < key) {
-        if (curNode->right == nullptr) {
-            curNode->right = new AVLNode(key, value, curNode);
-            if (curNode->getHeight() == 0) {
-                curNode->height = 1;
+    else if (this->evictionPolicy == EvictionPolicy::Clock) {
+        //sweep giving referenced nodes a second chance, at most two passes are needed
+        for (size_t steps = 0; steps <= 2 * this->treeSize; steps++) {
+            if (this->clockHand == nullptr) {
+                this->clockHand = this->recencyHead;
             }
-            return true;
-        }
-        else {
-            //insert was not completed return failure
-            if (!insertNode(key, value, curNode->right)) {
-                return false;
+            AVLNode* candidate = this->clockHand;
+            if (candidate == nullptr) {
+                break;
+            }
+            this->clockHand = candidate->useNext;
+            if (candidate == keep) {
+                continue;
+            }
+            if (candidate->referenced) {
+                candidate->referenced = false;
+            }
+            else {
+                victim = candidate;
+                break;
             }
         }
     }
-    //go down left side of node for insertion place
-    else if (curNode->key > key) {
-        if (curNode->left == nullptr) {
-            curNode->left = new AVLNode(key, value, curNode);
-            if (curNode->getHeight() == 0) {
-                curNode->height = 1;
-            }
-            return true;
+    else {
+        //smallest or largest key is at the end of the left or right spine
+        bool smallest = this->evictionPolicy == EvictionPolicy::SmallestKey;
+        victim = this->root;
+        while (victim != nullptr and (smallest ? victim->left : victim->right) != nullptr) {
+            victim = smallest ? victim->left : victim->right;
         }
-        else {
-            if (!insertNode(key, value, curNode->left)) {
-                return false;
+        //keep is at the end so take the key next to it
+        if (victim != nullptr and victim == keep) {
+            AVLNode* child = smallest ? victim->right : victim->left;
+            if (child != nullptr) {
+                victim = child;
+                while ((smallest ? victim->left : victim->right) != nullptr) {
+                    victim = smallest ? victim->left : victim->right;
+                }
+            }
+            else {
+                victim = victim->parent;
             }
         }
     }
-    //Key found return false
-    else if (curNode->key == key) {
-        return false;
+    return victim;
+}
+
+/*
+ *  enforceCapacity - evict keys until the tree is back within its limits
+ *
+ *  params
+ *      keep - node that must stay, usually the one just inserted
+ */
+void AVLTree::enforceCapacity(AVLNode *keep) {
+    while ((this->maxEntries != 0 and this->treeSize > this->maxEntries) or
+           (this->maxBytes != 0 and this->treeBytes > this->maxBytes)) {
+        AVLNode* victim = chooseVictim(keep);
+        if (victim == nullptr) {
+            return;
+        }
+        std::string victimKey = victim->key;
+        removeKey(victimKey);
     }
+}
 
-    //Set curNode height based off children height while exiting recursion
-    if ((curNode->left != nullptr && (curNode->left->getHeight() == curNode->getHeight()))
-        or (curNode->right != nullptr && (curNode->right->getHeight() == curNode->getHeight()))){
-            curNode->height++;
+/*
+ *  assignSorted - replace the contents of the tree with a balanced tree built from sorted entries. The middle entry
+ *      of each range becomes the top of its subtree, so the two sides differ in height by at most one and the
+ *      result is a valid AVL and WAVL tree without any rotations
+ *
+ *  params
+ *      entries - keys in strictly increasing order with their values
+ *
+ *  returns - false if the keys are not strictly increasing, the tree is then left as it was
+ */
+bool AVLTree::assignSorted(std::span<const std::pair<std::string_view, size_t>> entries) {
+    for (size_t i = 1; i < entries.size(); i++) {
+        if (!(entries[i - 1].first < entries[i].first)) {
+            return false;
         }
+    }
 
-    //attempt to balance tree
-    balanceNode(curNode);
+    clear();
+    //sized up front so linkNode never rebuilds the filter from a half built tree
+    if (this->filter != nullptr and entries.size() > this->filter->capacity()) {
+        rebuildFilter(entries.size());
+    }
+    this->root = buildSortedHelper(entries, nullptr);
+    //linkNode pushed each node as the newest, start the recency list over in key order as a copy does
+    rebuildRecencyList();
+    enforceCapacity(nullptr);
     return true;
 }
 
 /*
- *  balanceNode - look at balance of node if 2 or -2 need to execute rotations around node
+ *  buildSortedHelper - recursive helper for assignSorted
  *
  *  params
- *      node  - current node being accessed
+ *      entries - sorted entries of this subtree
+ *      parent - node the subtree hangs from, nullptr for the root
+ *
+ *  returns - top of the new subtree, nullptr for no entries
  */
-void AVLTree::balanceNode(AVLNode *&node) {
-    int balance = node->getBalance();
+AVLTree::AVLNode* AVLTree::buildSortedHelper(std::span<const std::pair<std::string_view, size_t>> entries, AVLNode *parent) {
+    if (entries.empty()) {
+        return nullptr;
+    }
+    size_t middle = entries.size() / 2;
+    AVLNode* node = new AVLNode(std::string(entries[middle].first), entries[middle].second, parent);
+    node->left = buildSortedHelper(entries.first(middle), node);
+    linkNode(node);
+    node->right = buildSortedHelper(entries.subspan(middle + 1), node);
+
+    //WAVL ranks are set here too, updateNode leaves them alone
+    long leftHeight = rankOf(node->left);
+    long rightHeight = rankOf(node->right);
+    node->height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+    updateNode(node);
+    return node;
+}
+
+/*
+ * operator[] - allows access to value given key value. A missing key is inserted with value 0
+ *
+ * returns - size_t reference so that the value can be modified
+ */
+size_t& AVLTree::operator[](const std::string &key) {
+    if (this->traceRecorder != nullptr) {
+        this->traceRecorder->record(TraceOp::Index, key);
+    }
+    return try_emplace(key, 0).first;
+}
+
+/*
+ * keys - returns all values from tree into a vector in key order
+ *
+ *  returns - vector containing all values
+ *
+ */
+std::vector<std::string> AVLTree::keys() const {
+    std::vector<std::string> returnVector;
+    //recursive function that navigates tree, buffered keys are merged in as it goes
+    size_t bufferIndex = 0;
+    keysHelper(this->root, returnVector, bufferIndex);
+    for (; bufferIndex < this->writeBuffer.size(); bufferIndex++) {
+        returnVector.push_back(std::to_string(this->writeBuffer[bufferIndex].value));
+    }
+    return returnVector;
+}
+
+/*
+ *  keysHelper - recursive in order walk adding every node value to vector, buffered keys that come before a node
+ *      are added ahead of it
+ *
+ *  params
+ *      curNode - the current node being looked at in the tree
+ *      returnVector - vector that is getting added to
+ *      bufferIndex - next buffered key to add, moved past the ones added
+ */
+void AVLTree::keysHelper(AVLNode* curNode, vector<std::string>& returnVector, size_t& bufferIndex) const {
+    //bottom of tree
+    if (curNode == nullptr) {
+        return;
+    }
+    keysHelper(curNode->left, returnVector, bufferIndex);
+    for (; bufferIndex < this->writeBuffer.size() and this->writeBuffer[bufferIndex].key < curNode->key; bufferIndex++) {
+        returnVector.push_back(std::to_string(this->writeBuffer[bufferIndex].value));
+    }
+    if (!isExpired(curNode)) {
+        returnVector.push_back(std::to_string(curNode->value));
+    }
+    keysHelper(curNode->right, returnVector, bufferIndex);
+}
+
+/*
+ *  removeNode - function containing logic needed when deleting nodes from tree. Need to check children amount and decide
+ *      on delete logic from there.
+ *
+ *  params
+ *      current - the current node being looked at in the tree
+ *
+ *  returns - boolean false if not deleted true if it is deleted
+ *
+ */
+bool AVLTree::removeNode(AVLNode*& current){
+    if (!current) {
+        return false;
+    }
+
+    AVLNode* toDelete = current;
+    auto nChildren = current->numChildren();
+
+    //If bottom node just delete it
+    if (current->isLeaf()) {
+        // case 1 we can delete the node
+        current = nullptr;
+        removedParent = toDelete->parent;
+        removedChild = nullptr;
+    } else if (nChildren == 1) {
+        // case 2 - replace current with its only child
+        if (current->right) {
+            current->right->parent = current->parent;
+            current = current->right;
+        } else {
+            current->left->parent = current->parent;
+            current = current->left;
+        }
+        removedParent = toDelete->parent;
+        removedChild = current;
+    } else {
+        // case 3 - we have two children,
+        // unlink the node with the smallest key in the right subtree
+        // and move that node into the place of current
+        AVLNode* smallestInRight = detachSmallest(current->right);
+        //the hole is where smallestInRight was, which is below it once it has moved up
+        removedParent = (smallestInRight->parent == current) ? smallestInRight : smallestInRight->parent;
+        removedChild = smallestInRight->right;
+        smallestInRight->height = current->height;
+
+        smallestInRight->left = current->left;
+        smallestInRight->right = current->right;
+        smallestInRight->parent = current->parent;
+        if (smallestInRight->left != nullptr) {
+            smallestInRight->left->parent = smallestInRight;
+        }
+        if (smallestInRight->right != nullptr) {
+            smallestInRight->right->parent = smallestInRight;
+        }
+        current = smallestInRight;
+
+        updateNode(current);
+        balanceNode(current);
+    }
+    unlinkNode(toDelete);
+    freeNode(toDelete);
+
+    return true;
+}
+
+/*
+ *  detachSmallest - recursive helper that unlinks the leftmost node below node without deleting it.
+ *      Nodes on the way back up are updated and balanced
+ *
+ *  params
+ *      node - link to the top of the subtree being searched
+ *
+ *  returns - the unlinked node
+ */
+AVLTree::AVLNode* AVLTree::detachSmallest(AVLNode*& node) {
+    //Found smallest, its right child (if any) takes its place
+    if (node->left == nullptr) {
+        AVLNode* smallest = node;
+        node = node->right;
+        if (node != nullptr) {
+            node->parent = smallest->parent;
+        }
+        return smallest;
+    }
+
+    AVLNode* smallest = detachSmallest(node->left);
+    updateNode(node);
+    balanceNode(node);
+    return smallest;
+}
+
+/*
+ *  remove - recursive helper function used to recursivley go through list and find the node to remove
+ *
+ *  params
+ *      current - the current node being looked at in the tree
+ *      key  - key being searched for to remove
+ *
+ *  returns - boolean true if a node was removed below current false if key was not found
+ */
+bool AVLTree::remove(AVLNode *&current, const std::string& key) {
+    //Bottom of tree key is not present
+    if (current == nullptr) {
+        return false;
+    }
+
+    if (current->key == key) {
+        //Remove node from list and return out of recursion
+        return removeNode(current);
+    }
+
+    bool removed;
+    if (current->key < key) {
+        removed = remove(current->right, key);
+    }
+    else {
+        removed = remove(current->left, key);
+    }
+
+    //Height and balance need checked all the way up if a node was removed
+    if (removed) {
+        updateNode(current);
+        balanceNode(current);
+    }
+    return removed;
+}
+
+/*
+ *  remove - remove base function takes a key and uses recursive helper function to find and remove node
+ *
+ *  params
+ *      key  - key being searched for to remove
+ *
+ *  returns - boolean true if done false if failed, an expired key is removed but reports false
+ */
+bool AVLTree::remove(const std::string &key) {
+    LatencyTimer timer(latencyHistogram(TimedOp::Remove));
+    if (this->traceRecorder != nullptr) {
+        this->traceRecorder->record(TraceOp::Remove, key);
+    }
+    //a buffered key only has to leave the buffer
+    size_t position = bufferPosition(key);
+    if (position < this->writeBuffer.size() and this->writeBuffer[position].key == key) {
+        this->writeBuffer.erase(this->writeBuffer.begin() + position);
+        return true;
+    }
+    //readers already treat an expired key as absent, so it is reclaimed without being reported as removed
+    if (this->ttlKeys != 0) {
+        AVLNode* node = getNodePlace(key, this->root);
+        if (node != nullptr and isExpired(node)) {
+            removeKey(key);
+            return false;
+        }
+    }
+    return removeKey(key);
+}
+
+/*
+ *  insert - Insert node based off key and value data. If already in list fail to add
+ *
+ *  params
+ *      key  - key being used to insert
+ *      value - the size_t value to store in the node
+ *
+ *  returns - boolean true if done false if failed
+ */
+bool AVLTree::insert(const std::string& key, size_t value){
+    LatencyTimer timer(latencyHistogram(TimedOp::Insert));
+    if (this->traceRecorder != nullptr) {
+        this->traceRecorder->record(TraceOp::Insert, key, value);
+    }
+    if (this->writeBufferLimit != 0) {
+        return bufferInsert(key, value);
+    }
+    //no reference is handed out, so a key that is already there is left untouched
+    std::string newKey = key;
+    bool inserted = false;
+    emplaceNode(newKey, value, inserted);
+    return inserted;
+}
+
+/*
+ *  try_emplace - insert key with value if it is not in the tree. Only one descent is made and the key is moved into
+ *      the new node
+ *
+ *  params
+ *      key  - key being inserted
+ *      value - value to store if key is inserted
+ *
+ *  returns - reference to the value stored for key and true if key was inserted
+ */
+std::pair<size_t&, bool> AVLTree::try_emplace(std::string key, size_t value) {
+    bool inserted = false;
+    AVLNode* node = emplaceNode(key, value, inserted);
+    if (!inserted) {
+        //the value can be written through the returned reference
+        markDirty(node);
+        touchNode(node);
+    }
+    recordChangeByReference(node);
+    return {node->value, inserted};
+}
+
+/*
+ *  insert_or_assign - insert key with value, or overwrite the value if key is already present
+ *
+ *  params
+ *      key  - key being inserted
+ *      value - value to store
+ *
+ *  returns - true if key was inserted false if an existing value was overwritten
+ */
+bool AVLTree::insert_or_assign(std::string key, size_t value) {
+    flushIfBuffered(key);
+    bool inserted = false;
+    AVLNode* node = insertNode(key, value, this->root, nullptr, inserted);
+    if (inserted) {
+        finishInsert(node);
+    }
+    else if (isExpired(node)) {
+        reviveNode(node, value);
+        inserted = true;
+    }
+    else {
+        node->value = value;
+        refreshAggregates(node);
+        markDirty(node);
+        touchNode(node);
+        recordChange(ChangeOp::Update, node->key, value);
+    }
+    return inserted;
+}
+
+/*
+ *  update - replace the value of an existing key with fn(value)
+ *
+ *  params
+ *      key  - key being updated
+ *      fn - function given the current value that returns the new one
+ *
+ *  returns - true if key was found false if it is not in the tree
+ */
+bool AVLTree::update(const std::string &key, const std::function<size_t(size_t)> &fn) {
+    flushIfBuffered(key);
+    AVLNode* node = getNodePlace(key, this->root);
+    if (node == nullptr or isExpired(node)) {
+        return false;
+    }
+    node->value = fn(node->value);
+    refreshAggregates(node);
+    markDirty(node);
+    touchNode(node);
+    recordChange(ChangeOp::Update, node->key, node->value);
+    return true;
+}
+
+/*
+ *  upsert - insert key with defaultValue if it is not in the tree, otherwise replace its value with fn(value).
+ *      Only one descent is made
+ *
+ *  params
+ *      key  - key being inserted or updated
+ *      defaultValue - value stored when key is inserted
+ *      fn - function given the current value that returns the new one
+ *
+ *  returns - reference to the value stored for key
+ */
+size_t& AVLTree::upsert(std::string key, size_t defaultValue, const std::function<size_t(size_t)> &fn) {
+    AVLNode* node = upsertNode(key, defaultValue, fn);
+    recordChangeByReference(node);
+    return node->value;
+}
+
+/*
+ *  insert - insert key with value and an expiry. The write buffer is skipped so the expiry is set on the node
+ *
+ *  params
+ *      key  - key being used to insert
+ *      value - the size_t value to store in the node
+ *      ttl - time from now until key expires
+ *
+ *  returns - true if key was inserted, false if a live key was already there (its expiry is left alone)
+ */
+bool AVLTree::insert(const std::string &key, size_t value, std::chrono::milliseconds ttl) {
+    LatencyTimer timer(latencyHistogram(TimedOp::Insert));
+    if (this->traceRecorder != nullptr) {
+        this->traceRecorder->record(TraceOp::InsertTTL, key, value, nullptr, ttl);
+    }
+    std::string newKey = key;
+    bool inserted = false;
+    AVLNode* node = emplaceNode(newKey, value, inserted);
+    if (inserted) {
+        setExpiry(node, std::chrono::steady_clock::now() + ttl);
+    }
+    return inserted;
+}
+
+/*
+ *  upsert - upsert that also sets the expiry of key to ttl from now, whether it was inserted or updated
+ */
+size_t& AVLTree::upsert(std::string key, size_t defaultValue, const std::function<size_t(size_t)> &fn, std::chrono::milliseconds ttl) {
+    AVLNode* node = upsertNode(key, defaultValue, fn);
+    setExpiry(node, std::chrono::steady_clock::now() + ttl);
+    recordChangeByReference(node);
+    return node->value;
+}
+
+/*
+ *  expire - set a new expiry on a key that is still live
+ *
+ *  params
+ *      key - key to expire
+ *      ttl - time from now until key expires
+ *
+ *  returns - false if key is not in the tree or has already expired
+ */
+bool AVLTree::expire(const std::string &key, std::chrono::milliseconds ttl) {
+    flushIfBuffered(key);
+    AVLNode* node = getNodePlace(key, this->root);
+    if (node == nullptr or isExpired(node)) {
+        return false;
+    }
+    setExpiry(node, std::chrono::steady_clock::now() + ttl);
+    return true;
+}
+
+/*
+ *  sweepExpired - pop expired entries off the expiry queue and remove their keys. Entries whose key was removed
+ *      or given a new expiry since are dropped without counting against maxKeys
+ *
+ *  params
+ *      maxKeys - most keys to remove in this call
+ *
+ *  returns - number of keys removed
+ */
+size_t AVLTree::sweepExpired(size_t maxKeys) {
+    auto now = std::chrono::steady_clock::now();
+    size_t removed = 0;
+    while (removed < maxKeys and !this->expiryQueue.empty() and this->expiryQueue.front().expiresAt <= now) {
+        std::pop_heap(this->expiryQueue.begin(), this->expiryQueue.end(), expiresLater);
+        ExpiryEntry entry = std::move(this->expiryQueue.back());
+        this->expiryQueue.pop_back();
+
+        AVLNode* node = getNodePlace(entry.key, this->root);
+        if (node == nullptr or node->expiresAt != entry.expiresAt) {
+            continue;
+        }
+        removeKey(entry.key);
+        removed++;
+    }
+    return removed;
+}
+
+/*
+ *  expiringKeys - returns the number of keys with an expiry, expired ones are counted until they are swept
+ */
+size_t AVLTree::expiringKeys() const {
+    return this->ttlKeys;
+}
+
+/*
+ *  emplaceNode - shared by try_emplace and insert with a ttl. Only one descent is made and the key is moved into
+ *      the new node. A live key is left as it was, callers that hand out its value mark it themselves
+ *
+ *  params
+ *      key  - key being inserted, moved from if a node is made
+ *      value - value to store if key is inserted
+ *      inserted - set to true if key was absent or expired
+ *
+ *  returns - the node holding key
+ */
+AVLTree::AVLNode* AVLTree::emplaceNode(std::string &key, size_t value, bool &inserted) {
+    flushIfBuffered(key);
+    inserted = false;
+    //Find where the node should be inserted. Recusivley looks for lowest level
+    AVLNode* node = insertNode(key, value, this->root, nullptr, inserted);
+    if (inserted) {
+        finishInsert(node);
+    }
+    else if (isExpired(node)) {
+        reviveNode(node, value);
+        inserted = true;
+    }
+    return node;
+}
+
+/*
+ *  upsertNode - shared by both upserts, an expired key gets defaultValue as if it were absent
+ *
+ *  returns - the node holding key
+ */
+AVLTree::AVLNode* AVLTree::upsertNode(std::string &key, size_t defaultValue, const std::function<size_t(size_t)> &fn) {
+    flushIfBuffered(key);
+    bool inserted = false;
+    AVLNode* node = insertNode(key, defaultValue, this->root, nullptr, inserted);
+    if (inserted) {
+        finishInsert(node);
+    }
+    else if (isExpired(node)) {
+        reviveNode(node, defaultValue);
+    }
+    else {
+        node->value = fn(node->value);
+        refreshAggregates(node);
+        markDirty(node);
+        touchNode(node);
+        recordChange(ChangeOp::Update, node->key, node->value);
+    }
+    return node;
+}
+
+/*
+ *  isExpired - true if node has an expiry that has passed. The clock is only read for nodes with an expiry
+ */
+bool AVLTree::isExpired(const AVLNode *node) const {
+    return node->expiresAt != noExpiry and node->expiresAt <= std::chrono::steady_clock::now();
+}
+
+/*
+ *  reviveNode - reuse the node of an expired key for a new write of that key
+ *
+ *  params
+ *      node - expired node
+ *      value - value of the new write
+ */
+void AVLTree::reviveNode(AVLNode *node, size_t value) {
+    node->value = value;
+    setExpiry(node, noExpiry);
+    refreshAggregates(node);
+    markDirty(node);
+    touchNode(node);
+    //followers never saw the key expire, to them this is a new value
+    recordChange(ChangeOp::Insert, node->key, value);
+}
+
+/*
+ *  setExpiry - change when node expires and queue the new time. The old queue entry is left to be skipped, once
+ *      skipped entries outnumber the keys with an expiry the queue is rebuilt from the tree
+ *
+ *  params
+ *      node - node to change
+ *      expiresAt - new expiry, noExpiry for none
+ */
+void AVLTree::setExpiry(AVLNode *node, std::chrono::steady_clock::time_point expiresAt) {
+    if (node->expiresAt == noExpiry and expiresAt != noExpiry) {
+        this->ttlKeys++;
+    }
+    else if (node->expiresAt != noExpiry and expiresAt == noExpiry) {
+        this->ttlKeys--;
+    }
+    node->expiresAt = expiresAt;
+    if (expiresAt == noExpiry) {
+        return;
+    }
+
+    this->expiryQueue.push_back({expiresAt, node->key});
+    std::push_heap(this->expiryQueue.begin(), this->expiryQueue.end(), expiresLater);
+    if (this->expiryQueue.size() > 2 * this->ttlKeys + 64) {
+        rebuildExpiryQueue();
+    }
+}
+
+/*
+ *  expiresLater - heap order that keeps the soonest expiry on top
+ */
+bool AVLTree::expiresLater(const ExpiryEntry &a, const ExpiryEntry &b) {
+    return a.expiresAt > b.expiresAt;
+}
+
+/*
+ *  rebuildExpiryQueue - replace the queue with one entry per node that has an expiry
+ */
+void AVLTree::rebuildExpiryQueue() {
+    this->expiryQueue.clear();
+    expiryHelper(this->root);
+    std::make_heap(this->expiryQueue.begin(), this->expiryQueue.end(), expiresLater);
+}
+
+/*
+ *  expiryHelper - recursive helper that queues every node with an expiry below curNode
+ */
+void AVLTree::expiryHelper(AVLNode *curNode) {
+    if (curNode == nullptr) {
+        return;
+    }
+    if (curNode->expiresAt != noExpiry) {
+        this->expiryQueue.push_back({curNode->expiresAt, curNode->key});
+    }
+    expiryHelper(curNode->left);
+    expiryHelper(curNode->right);
+}
+
+/*
+ *  refreshAggregates - recompute aggregates from node up to the root after its value changed in place
+ *
+ *  params
+ *      node - node whose value changed
+ */
+void AVLTree::refreshAggregates(AVLNode *node) {
+    if (!this->aggregateFunction.combine) {
+        return;
+    }
+    while (node != nullptr) {
+        updateNode(node);
+        node = node->parent;
+    }
+}
+
+/*
+ *  contains - look to see if node is in tree already
+ *
+ *  params
+ *      key  - key being searched for
+ *
+ *  returns - boolean true if done false if failed
+ */
+bool AVLTree::contains(const std::string &key) const {
+    if (bufferedValue(key) != nullptr) {
+        return true;
+    }
+    if (filterRejects(key)) {
+        return false;
+    }
+    AVLNode* node = getNodePlace(key, this->root);
+    if (node != nullptr and isExpired(node)) {
+        return false;
+    }
+    if (node != nullptr) {
+        touchNode(node);
+        return true;
+    }
+    else {
+        filterMissed();
+        return false;
+    }
+}
+
+/*
+ *  get - look to see if node is in tree and if it is return value otherwise return nullopt
+ *
+ *  params
+ *      key  - key being searched for
+ *
+ *  returns - optional<size_t> value of node if present otherwise null opt
+ */
+std::optional<size_t> AVLTree::get(const std::string& key) const{
+    LatencyTimer timer(latencyHistogram(TimedOp::Get));
+    if (this->traceRecorder != nullptr) {
+        this->traceRecorder->record(TraceOp::Get, key);
+    }
+    const size_t* buffered = bufferedValue(key);
+    if (buffered != nullptr) {
+        return *buffered;
+    }
+    if (filterRejects(key)) {
+        return nullopt;
+    }
+
+    AVLNode *node = getNodePlace(key, this->root);
+    if (node != nullptr and isExpired(node)) {
+        return nullopt;
+    }
+
+    //if node is nullptr then it is not in tree
+    if (node != nullptr) {
+        touchNode(node);
+        return node->value;
+    }
+    else {
+        filterMissed();
+        return nullopt;
+    }
+}
+
+/*
+ *  getMany - look up a batch of keys. Sorted batches walk the tree once sharing the descent of neighbouring keys,
+ *      other batches run lookupGroupSize lookups interleaved so their cache misses overlap
+ *
+ *  params
+ *      keys  - keys being searched for
+ *      out - out[i] is set to the value of keys[i] or nullopt, must be at least as long as keys
+ */
+void AVLTree::getMany(std::span<const std::string> keys, std::span<std::optional<size_t>> out) const {
+    keys = keys.first(std::min(keys.size(), out.size()));
+    if (std::is_sorted(keys.begin(), keys.end())) {
+        getManySortedHelper(this->root, keys, out);
+    }
+    else {
+        getManyInterleaved(keys, out);
+    }
+
+    //keys missing from the tree may still be buffered
+    if (!this->writeBuffer.empty()) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            const size_t* buffered = out[i] ? nullptr : bufferedValue(keys[i]);
+            if (buffered != nullptr) {
+                out[i] = *buffered;
+            }
+        }
+    }
+}
+
+/*
+ *  getManyInterleaved - step a group of lookups down the tree one level at a time in turn. Each step prefetches the
+ *      next node of that lookup so it has arrived by the time the group comes back around to it
+ *
+ *  params
+ *      keys  - keys being searched for
+ *      out - out[i] is set to the value of keys[i] or nullopt
+ */
+void AVLTree::getManyInterleaved(std::span<const std::string> keys, std::span<std::optional<size_t>> out) const {
+    AVLNode* curNodes[lookupGroupSize];
+    size_t keyIndex[lookupGroupSize];
+    size_t active = 0;
+    size_t nextKey = 0;
+
+    //fill the group, keys the filter rules out never join it
+    while (active < lookupGroupSize and nextKey < keys.size()) {
+        if (filterRejects(keys[nextKey])) {
+            out[nextKey++] = nullopt;
+            continue;
+        }
+        curNodes[active] = this->root;
+        keyIndex[active] = nextKey++;
+        active++;
+    }
+
+    while (active > 0) {
+        for (size_t i = 0; i < active; ) {
+            AVLNode* node = curNodes[i];
+            const std::string& key = keys[keyIndex[i]];
+            int compare = (node != nullptr) ? key.compare(node->key) : 0;
+
+            //lookup is still going, move one level down
+            if (node != nullptr and compare != 0) {
+                node = (compare > 0) ? node->right : node->left;
+                AVL_PREFETCH(node);
+                curNodes[i] = node;
+                i++;
+                continue;
+            }
+
+            //lookup done, hit or bottom of tree
+            if (node != nullptr and isExpired(node)) {
+                out[keyIndex[i]] = nullopt;
+            }
+            else if (node != nullptr) {
+                touchNode(node);
+                out[keyIndex[i]] = node->value;
+            }
+            else {
+                filterMissed();
+                out[keyIndex[i]] = nullopt;
+            }
+
+            //refill the slot with the next key or shrink the group
+            while (nextKey < keys.size() and filterRejects(keys[nextKey])) {
+                out[nextKey++] = nullopt;
+            }
+            if (nextKey < keys.size()) {
+                curNodes[i] = this->root;
+                keyIndex[i] = nextKey++;
+                i++;
+            }
+            else {
+                active--;
+                curNodes[i] = curNodes[active];
+                keyIndex[i] = keyIndex[active];
+            }
+        }
+    }
+}
+
+/*
+ *  getManySortedHelper - recursive helper for sorted batches. The keys are split around curNode and each side only
+ *      continues down the matching subtree, so keys sharing a path only walk it once
+ *
+ *  params
+ *      curNode - the node currently being used
+ *      keys  - sorted keys that belong in curNodes subtree
+ *      out - out[i] is set to the value of keys[i] or nullopt
+ */
+void AVLTree::getManySortedHelper(AVLNode *curNode, std::span<const std::string> keys, std::span<std::optional<size_t>> out) const {
+    if (keys.empty()) {
+        return;
+    }
+    //Found bottom of tree none of the keys are present
+    if (curNode == nullptr) {
+        std::fill(out.begin(), out.begin() + keys.size(), nullopt);
+        return;
+    }
+    AVL_PREFETCH(curNode->left);
+    AVL_PREFETCH(curNode->right);
+
+    //keys before lower go left, keys from upper on go right, keys between match curNode
+    auto range = std::equal_range(keys.begin(), keys.end(), curNode->key);
+    size_t lower = range.first - keys.begin();
+    size_t upper = range.second - keys.begin();
+    if (lower != upper and isExpired(curNode)) {
+        std::fill(out.begin() + lower, out.begin() + upper, nullopt);
+    }
+    else if (lower != upper) {
+        std::fill(out.begin() + lower, out.begin() + upper, curNode->value);
+        touchNode(curNode);
+    }
+
+    getManySortedHelper(curNode->left, keys.first(lower), out.first(lower));
+    getManySortedHelper(curNode->right, keys.subspan(upper), out.subspan(upper));
+}
+
+/*
+ *  getNodePlace - recursive helper function used to recursivley go through list and find a node
+ *
+ *  params
+ *      key  - key being searched for
+ *      curNode - the node currently being used
+ *
+ *  returns - the pointer to the node found
+ */
+AVLTree::AVLNode* AVLTree::getNodePlace(const std::string& key, AVLTree::AVLNode* curNode) const{
+    //Found bottom of list node is not present
+    if (curNode == nullptr) {
+        return curNode;
+    }
+    //Found node return out
+    else if (curNode->key == key) {
+        return curNode;
+    }
+    //Can still continue search through right node
+    else if (curNode->key < key) {
+        return getNodePlace(key, curNode->right);
+    }
+    //Can still continue search through left node
+    else {
+        return getNodePlace(key, curNode->left);
+    }
+}
+
+/*
+ *  insertNode - recursive helper used to find the node for key or the proper spot to insert it. Balance is checked for
+ *      and done if needed on the way back up when a node was inserted
+ *
+ *  params
+ *      key  - key to insert, moved into the new node if one is created
+ *      value  - value to insert
+ *      curNode  - link to the current node being accessed
+ *      parent - parent of curNode
+ *      inserted - set to true if a new node was created
+ *
+ *  returns - the node holding key
+ */
+AVLTree::AVLNode* AVLTree::insertNode(std::string& key, size_t value, AVLNode*& curNode, AVLNode* parent, bool& inserted) {
+    //Bottom of tree insert
+    if (curNode == nullptr) {
+        curNode = new AVLNode(std::move(key), value, parent);
+        linkNode(curNode);
+        inserted = true;
+        return curNode;
+    }
+
+    int compare = key.compare(curNode->key);
+    //Key found nothing to insert
+    if (compare == 0) {
+        inserted = false;
+        return curNode;
+    }
+
+    //Go down right or left side of node to find where to insert
+    AVLNode* node;
+    if (compare > 0) {
+        node = insertNode(key, value, curNode->right, curNode, inserted);
+    }
+    else {
+        node = insertNode(key, value, curNode->left, curNode, inserted);
+    }
+
+    //Set curNode height and aggregate based off children while exiting recursion then attempt to balance tree
+    if (inserted) {
+        updateNode(curNode);
+        balanceNode(curNode);
+    }
+    return node;
+}
+
+/*
+ *  balanceNode - look at balance of node if 2 or -2 need to execute rotations around node
+ *
+ *  params
+ *      node  - current node being accessed
+ */
+void AVLTree::balanceNode(AVLNode *&node) {
+    //WAVL rebalances in one pass after the change instead of at every level
+    if (this->balancePolicy == BalancePolicy::WAVL) {
+        return;
+    }
+
+    int balance = node->getBalance();
+
+    //right side is too tall
+    if (balance < -1) {
+        //right then left rotate when the right node leans left
+        if (node->right->getBalance() > 0) {
+            RightRotate(node->right);
+        }
+        LeftRotate(node);
+    }
+    //left side is too tall
+    else if (balance > 1) {
+        //left then right rotate when the left node leans right
+        if (node->left->getBalance() < 0) {
+            LeftRotate(node->left);
+        }
+        RightRotate(node);
+    }
+}
+
+/*
+ *  updateNode - recompute a nodes height and aggregate from its children. Children must already be up to date
+ *
+ *  params
+ *      node  - node to update
+ */
+void AVLTree::updateNode(AVLNode *node) {
+    //WAVL ranks are only changed by promotions and demotions
+    if (this->balancePolicy == BalancePolicy::AVL) {
+        //missing children count as height -1
+        long leftHeight = rankOf(node->left);
+        long rightHeight = rankOf(node->right);
+        node->height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+    }
+
+    //rotations move dirty nodes between subtrees
+    node->subtreeDirty = node->dirty or (node->left != nullptr and node->left->subtreeDirty) or
+                         (node->right != nullptr and node->right->subtreeDirty);
+
+    if (this->aggregateFunction.combine) {
+        node->aggregate = this->aggregateFunction.combine(
+            this->aggregateFunction.combine(subtreeAggregate(node->left), node->value),
+            subtreeAggregate(node->right));
+    }
+}
+
+/*
+ *  replaceChild - swap which node a parent points to, used when a node changes places in the tree
+ *
+ *  params
+ *      parent - parent of oldChild, nullptr when oldChild is the root
+ *      oldChild - node being replaced
+ *      newChild - node taking its place
+ */
+void AVLTree::replaceChild(AVLNode *parent, AVLNode *oldChild, AVLNode *newChild) {
+    if (parent == nullptr) {
+        this->root = newChild;
+    }
+    else if (parent->left == oldChild) {
+        parent->left = newChild;
+    }
+    else {
+        parent->right = newChild;
+    }
+}
+
+/*
+ *  RightRotate - rotate pivotNodes left child up into pivotNodes place
+ *
+ *  params
+ *      pivotNode - node to rotate around, must have a left child
+ */
+void AVLTree::RightRotate(AVLNode* pivotNode) {
+    AVLNode* leftNode = pivotNode->left;
+    this->rotationCount++;
+
+    //left nodes right subtree moves under pivot
+    pivotNode->left = leftNode->right;
+    if (pivotNode->left != nullptr) {
+        pivotNode->left->parent = pivotNode;
+    }
+
+    //adjust pivot and left nodes for new positions
+    leftNode->parent = pivotNode->parent;
+    replaceChild(pivotNode->parent, pivotNode, leftNode);
+    leftNode->right = pivotNode;
+    pivotNode->parent = leftNode;
+
+    //pivot is now below left node so update it first
+    updateNode(pivotNode);
+    updateNode(leftNode);
+}
+
+/*
+ *  LeftRotate - rotate pivotNodes right child up into pivotNodes place
+ *
+ *  params
+ *      pivotNode - node to rotate around, must have a right child
+ */
+void AVLTree::LeftRotate(AVLNode* pivotNode) {
+    AVLNode* rightNode = pivotNode->right;
+    this->rotationCount++;
+
+    //right nodes left subtree moves under pivot
+    pivotNode->right = rightNode->left;
+    if (pivotNode->right != nullptr) {
+        pivotNode->right->parent = pivotNode;
+    }
+
+    //adjust pivot and right nodes for new positions
+    rightNode->parent = pivotNode->parent;
+    replaceChild(pivotNode->parent, pivotNode, rightNode);
+    rightNode->left = pivotNode;
+    pivotNode->parent = rightNode;
+
+    //pivot is now below right node so update it first
+    updateNode(pivotNode);
+    updateNode(rightNode);
+}
+
+/*
+ *  finishInsert - work left after insertNode created a node. WAVL rebalances from the new leaf and the tree
+ *      evicts if it is now over capacity
+ *
+ *  params
+ *      node - the new node
+ */
+void AVLTree::finishInsert(AVLNode *node) {
+    if (!this->reclaimQueue.empty()) {
+        reclaim(reclaimBatchSize);
+    }
+    if (this->balancePolicy == BalancePolicy::WAVL) {
+        wavlInsertFixup(node);
+    }
+    enforceCapacity(node);
+}
+
+/*
+ *  removeKey - remove key through the recursive remove then let WAVL rebalance from the hole left behind
+ *
+ *  params
+ *      key - key to remove
+ *
+ *  returns - true if key was removed
+ */
+bool AVLTree::removeKey(const std::string &key) {
+    if (!this->reclaimQueue.empty()) {
+        reclaim(reclaimBatchSize);
+    }
+    if (!remove(this->root, key)) {
+        return false;
+    }
+    if (this->balancePolicy == BalancePolicy::WAVL) {
+        wavlDeleteFixup(this->removedParent, this->removedChild);
+    }
+    return true;
+}
+
+/*
+ *  setBalancePolicy - change how the tree balances. Every AVL tree is already a valid WAVL tree, but a WAVL tree
+ *      may not meet the AVL rule so that switch needs an empty tree
+ *
+ *  params
+ *      policy - policy to use from now on
+ *
+ *  returns - true if the policy was changed
+ */
+bool AVLTree::setBalancePolicy(BalancePolicy policy) {
+    if (policy == BalancePolicy::AVL and this->balancePolicy == BalancePolicy::WAVL and this->root != nullptr) {
+        return false;
+    }
+    this->balancePolicy = policy;
+    return true;
+}
+
+/*
+ *  getBalancePolicy - returns the policy the tree is balanced by
+ */
+AVLTree::BalancePolicy AVLTree::getBalancePolicy() const {
+    return this->balancePolicy;
+}
+
+/*
+ *  rotations - returns how many single rotations the tree has done, a double rotation counts as two
+ */
+size_t AVLTree::rotations() const {
+    return this->rotationCount;
+}
+
+/*
+ *  checkInvariants - walks the whole tree checking the search order, parent links, balance, aggregates and counts
+ *
+ *      returns true if nothing is out of place
+ */
+bool AVLTree::checkInvariants() const {
+    size_t nodeCount = 0;
+    size_t byteCount = 0;
+    if (this->root != nullptr and this->root->parent != nullptr) {
+        return false;
+    }
+    if (!invariantHelper(this->root, nullptr, nullptr, nullptr, nodeCount, byteCount)) {
+        return false;
+    }
+    if (nodeCount != this->treeSize or byteCount != this->treeBytes) {
+        return false;
+    }
+
+    //every node is on the recency list exactly once while a policy uses it
+    if (usesRecencyList()) {
+        size_t listed = 0;
+        for (AVLNode* node = this->recencyHead; node != nullptr; node = node->useNext) {
+            if (node->useNext == nullptr ? node != this->recencyTail : node->useNext->usePrev != node) {
+                return false;
+            }
+            listed++;
+        }
+        if (listed != this->treeSize) {
+            return false;
+        }
+    }
+
+    //the buffer stays sorted and holds none of the tree keys
+    for (size_t i = 0; i < this->writeBuffer.size(); i++) {
+        if (i > 0 and !(this->writeBuffer[i - 1].key < this->writeBuffer[i].key)) {
+            return false;
+        }
+        if (getNodePlace(this->writeBuffer[i].key, this->root) != nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ *  invariantHelper - checks one subtree, AVL heights must be exact with children at most one apart, WAVL ranks
+ *      must be 1 or 2 above each child (a missing child has rank -1) with leaves at rank 0
+ *
+ *  params
+ *      curNode - top of the subtree, may be nullptr
+ *      parent - node curNode should point back to
+ *      lowKey, highKey - exclusive bounds on the keys of the subtree, nullptr for no bound
+ *      nodeCount, byteCount - nodes and their nodeBytes are added to these
+ *
+ *      returns true if the subtree is well formed
+ */
+bool AVLTree::invariantHelper(const AVLNode *curNode, const AVLNode *parent, const std::string *lowKey,
+                              const std::string *highKey, size_t &nodeCount, size_t &byteCount) const {
+    if (curNode == nullptr) {
+        return true;
+    }
+    if (curNode->parent != parent) {
+        return false;
+    }
+    if ((lowKey != nullptr and !(*lowKey < curNode->key)) or (highKey != nullptr and !(curNode->key < *highKey))) {
+        return false;
+    }
+
+    long leftRank = rankOf(curNode->left);
+    long rightRank = rankOf(curNode->right);
+    long rank = rankOf(curNode);
+    if (this->balancePolicy == BalancePolicy::AVL) {
+        if (rank != (leftRank > rightRank ? leftRank : rightRank) + 1 or
+            leftRank - rightRank > 1 or rightRank - leftRank > 1) {
+            return false;
+        }
+    }
+    else {
+        if (rank - leftRank < 1 or rank - leftRank > 2 or rank - rightRank < 1 or rank - rightRank > 2) {
+            return false;
+        }
+        if (curNode->isLeaf() and rank != 0) {
+            return false;
+        }
+    }
+
+    if (this->aggregateFunction.combine) {
+        size_t leftAggregate = (curNode->left != nullptr) ? curNode->left->aggregate : this->aggregateFunction.identity;
+        size_t rightAggregate = (curNode->right != nullptr) ? curNode->right->aggregate : this->aggregateFunction.identity;
+        if (curNode->aggregate != this->aggregateFunction.combine(
+                this->aggregateFunction.combine(leftAggregate, curNode->value), rightAggregate)) {
+            return false;
+        }
+    }
+
+    bool belowDirty = (curNode->left != nullptr and curNode->left->subtreeDirty) or
+                      (curNode->right != nullptr and curNode->right->subtreeDirty);
+    //a stale subtreeDirty only costs a wasted visit, a missing one would leave a change out of the next checkpoint
+    if ((curNode->dirty or belowDirty) and !curNode->subtreeDirty) {
+        return false;
+    }
+
+    nodeCount++;
+    byteCount += nodeBytes(curNode);
+    return invariantHelper(curNode->left, curNode, lowKey, &curNode->key, nodeCount, byteCount) and
+           invariantHelper(curNode->right, curNode, &curNode->key, highKey, nodeCount, byteCount);
+}
+
+/*
+ *  rankOf - rank of node, a missing node has rank -1
+ */
+long AVLTree::rankOf(const AVLNode *node) {
+    return (node != nullptr) ? (long) node->height : -1;
+}
+
+/*
+ *  wavlInsertFixup - a new leaf has rank 0, if its parent also has rank 0 the rank rule is broken. Parents whose
+ *      other child is a 1-child are promoted and the problem moves up, otherwise one or two rotations end it
+ *
+ *  params
+ *      node - newly inserted leaf
+ */
+void AVLTree::wavlInsertFixup(AVLNode *node) {
+    AVLNode* parent = node->parent;
+
+    //node is a 0-child of parent
+    while (parent != nullptr and parent->height == node->height) {
+        AVLNode* sibling = (parent->left == node) ? parent->right : parent->left;
+
+        //parent is 0,1 promote it and keep going up
+        if (rankOf(parent) - rankOf(sibling) == 1) {
+            parent->height++;
+            node = parent;
+            parent = parent->parent;
+            continue;
+        }
+
+        //parent is 0,2 so rotate
+        if (node == parent->left) {
+            AVLNode* inner = node->right;
+            if (rankOf(node) - rankOf(inner) == 2) {
+                RightRotate(parent);
+                parent->height--;
+            }
+            else {
+                LeftRotate(node);
+                RightRotate(parent);
+                inner->height++;
+                node->height--;
+                parent->height--;
+            }
+        }
+        else {
+            AVLNode* inner = node->left;
+            if (rankOf(node) - rankOf(inner) == 2) {
+                LeftRotate(parent);
+                parent->height--;
+            }
+            else {
+                RightRotate(node);
+                LeftRotate(parent);
+                inner->height++;
+                node->height--;
+                parent->height--;
+            }
+        }
+        return;
+    }
+}
+
+/*
+ *  wavlDeleteFixup - after a removal the node at the hole may be a 3-child or its parent a 2,2 leaf. Demotions move
+ *      the problem up the tree, at most two rotations end it
+ *
+ *  params
+ *      parent - node the removed node hung from, nullptr if it was the root
+ *      child - node now in the removed nodes place, may be nullptr
+ */
+void AVLTree::wavlDeleteFixup(AVLNode *parent, AVLNode *child) {
+    if (parent == nullptr) {
+        return;
+    }
+
+    //leaves must be 1,1 so a 2,2 leaf is demoted
+    if (parent->isLeaf() and parent->height == 1) {
+        parent->height = 0;
+        child = parent;
+        parent = parent->parent;
+    }
+
+    //child is a 3-child of parent
+    while (parent != nullptr and rankOf(parent) - rankOf(child) == 3) {
+        AVLNode* sibling = (parent->left == child) ? parent->right : parent->left;
+
+        if (rankOf(parent) - rankOf(sibling) == 2) {
+            //sibling is a 2-child, demoting parent is enough here
+            parent->height--;
+        }
+        else if (rankOf(sibling) - rankOf(sibling->left) == 2 and rankOf(sibling) - rankOf(sibling->right) == 2) {
+            //sibling is a 2,2 node, demote both
+            parent->height--;
+            sibling->height--;
+        }
+        //sibling has a 1-child, rotate it up and stop
+        else if (sibling == parent->right) {
+            AVLNode* inner = sibling->left;
+            if (rankOf(sibling) - rankOf(sibling->right) == 1) {
+                LeftRotate(parent);
+                sibling->height++;
+                parent->height--;
+                if (parent->isLeaf()) {
+                    parent->height--;
+                }
+            }
+            else {
+                RightRotate(sibling);
+                LeftRotate(parent);
+                inner->height += 2;
+                sibling->height--;
+                parent->height -= 2;
+            }
+            return;
+        }
+        else {
+            AVLNode* inner = sibling->right;
+            if (rankOf(sibling) - rankOf(sibling->left) == 1) {
+                RightRotate(parent);
+                sibling->height++;
+                parent->height--;
+                if (parent->isLeaf()) {
+                    parent->height--;
+                }
+            }
+            else {
+                LeftRotate(sibling);
+                RightRotate(parent);
+                inner->height += 2;
+                sibling->height--;
+                parent->height -= 2;
+            }
+            return;
+        }
+
+        child = parent;
+        parent = parent->parent;
+    }
+}
+
+AVLTree::AVLTree(const AVLTree &other) {
+    LatencyTimer timer(other.latencyHistogram(TimedOp::Copy));
+    this->root = nullptr;
+    this->treeSize = 0;
+    this->treeBytes = 0;
+    this->aggregateFunction = other.aggregateFunction;
+    this->maxEntries = other.maxEntries;
+    this->maxBytes = other.maxBytes;
+    this->evictionPolicy = other.evictionPolicy;
+    //a copy is not recorded into the same trace as the original
+    this->traceRecorder = nullptr;
+    this->balancePolicy = other.balancePolicy;
+    this->rotationCount = 0;
+    this->removedParent = nullptr;
+    this->removedChild = nullptr;
+    this->backgroundReclaim = other.backgroundReclaim;
+    this->writeBuffer = other.writeBuffer;
+    //predecessor hints point into the other tree
+    for (BufferedInsert& entry : this->writeBuffer) {
+        entry.predecessor = nullptr;
+        entry.structureVersion = SIZE_MAX;
+    }
+    this->writeBufferLimit = other.writeBufferLimit;
+    this->writeBufferMaxAge = other.writeBufferMaxAge;
+    this->writeBufferOldest = other.writeBufferOldest;
+    this->structureVersion = 0;
+    //timing is not copied, like the trace recorder
+    this->latencyHistograms = nullptr;
+    this->compactionNext = 0;
+    this->compactionActive = false;
+    this->compactionStale = false;
+    this->compactionGeneration = 0;
+    this->compactionBlock = nullptr;
+    this->compactionBlockUsed = 0;
+    this->expiryQueue = other.expiryQueue;
+    this->ttlKeys = other.ttlKeys;
+    //the feed is not copied, the copy can follow other from where other is now
+    this->changeLogLimit = 0;
+    this->changeCoalesce = false;
+    this->changeSequenceNumber = 0;
+    this->changesDroppedThrough = 0;
+    this->supersededChanges = 0;
+    this->appliedSequence = other.changeSequenceNumber;
+    this->filter = other.filter != nullptr ? new CountingBloomFilter(*other.filter) : nullptr;
+    this->filterFalsePositiveRate = other.filterFalsePositiveRate;
+    this->filterRejected = 0;
+    this->filterFalsePositives = 0;
+    //a copy has no checkpoint of its own yet
+    this->checkpointing = false;
+    this->checkpointSequence = 0;
+    if (other.root != nullptr) {
+        this->root = new AVLNode(*other.root, nullptr);
+        copyHelper(other.root, this->root);
+        treeSize = other.treeSize;
+        treeBytes = other.treeBytes;
+    }
+    //recency is not copied, the copy starts out in key order
+    rebuildRecencyList();
+}
+
+bool AVLTree::copyHelper(AVLNode* curNodeOld, AVLNode* curNode) const{
+    if (curNodeOld->isLeaf()) {
+        return false;
+    }
+
+    if (curNodeOld->left != nullptr) {
+        curNode->left = new AVLNode(*curNodeOld->left, curNode);
+        copyHelper(curNodeOld->left, curNode->left);
+    }
+
+    if (curNodeOld->right != nullptr) {
+        curNode->right = new AVLNode(*curNodeOld->right, curNode);
+        copyHelper(curNodeOld->right, curNode->right);
+    }
+
+    return true;
+}
+
+void AVLTree::operator=(const AVLTree &other) {
+    if (this == &other) {
+        return;
+    }
+    LatencyTimer timer(other.latencyHistogram(TimedOp::Copy));
+
+    finishCompaction();
+    //old nodes are freed like clear() so assignment does not pay for them
+    deleteHelper(this->root);
+    this->root = nullptr;
+    this->treeSize = 0;
+    this->treeBytes = 0;
+    this->aggregateFunction = other.aggregateFunction;
+    this->maxEntries = other.maxEntries;
+    this->maxBytes = other.maxBytes;
+    this->evictionPolicy = other.evictionPolicy;
+    this->balancePolicy = other.balancePolicy;
+    this->writeBuffer = other.writeBuffer;
+    //predecessor hints point into the other tree
+    for (BufferedInsert& entry : this->writeBuffer) {
+        entry.predecessor = nullptr;
+        entry.structureVersion = SIZE_MAX;
+    }
+    this->writeBufferLimit = other.writeBufferLimit;
+    this->writeBufferMaxAge = other.writeBufferMaxAge;
+    this->writeBufferOldest = other.writeBufferOldest;
+    //every key may have changed so the next checkpoint is a full snapshot
+    this->structureVersion++;
+    this->checkpointing = false;
+    this->removedKeys.clear();
+    this->expiryQueue = other.expiryQueue;
+    this->ttlKeys = other.ttlKeys;
+    this->appliedSequence = other.changeSequenceNumber;
+    delete this->filter;
+    this->filter = other.filter != nullptr ? new CountingBloomFilter(*other.filter) : nullptr;
+    this->filterFalsePositiveRate = other.filterFalsePositiveRate;
+    this->filterRejected = 0;
+    this->filterFalsePositives = 0;
+    if (other.root != nullptr) {
+        this->root = new AVLNode(*other.root, nullptr);
+        copyHelper(other.root, this->root);
+        this->treeSize = other.treeSize;
+        this->treeBytes = other.treeBytes;
+    }
+    rebuildRecencyList();
+    //followers of this tree see the assignment as a clear and an insert of every copied key
+    if (this->changeLogLimit != 0) {
+        recordChange(ChangeOp::Clear, std::string(), 0);
+        changeHelper(this->root);
+    }
+}
+
+/*
+ *  setWriteBuffer - put a small sorted buffer in front of the tree for insert(). A buffered insert only checks the
+ *      key is new, the allocation and rebalancing happen later when the whole buffer is merged in key order
+ *
+ *  params
+ *      maxEntries - buffered keys that trigger a merge, 0 merges now and stops buffering
+ *      maxAge - age of the oldest buffered key that triggers a merge on the next insert, 0 for no limit
+ */
+void AVLTree::setWriteBuffer(size_t maxEntries, std::chrono::milliseconds maxAge) {
+    this->writeBufferLimit = maxEntries;
+    this->writeBufferMaxAge = maxAge;
+    if (maxEntries == 0 or this->writeBuffer.size() >= maxEntries) {
+        flushWriteBuffer();
+    }
+}
+
+/*
+ *  flushWriteBuffer - merge every buffered key into the tree in key order. The predecessor found when a key was
+ *      buffered tells where it goes, so while no other node has been linked or unlinked since then the key is
+ *      attached there and balanced upward without a second descent. Otherwise (or when the filter let the key
+ *      skip that descent) its place is searched for starting from the key merged before it
+ */
+void AVLTree::flushWriteBuffer() {
+    std::vector<BufferedInsert> entries;
+    entries.swap(this->writeBuffer);
+
+    size_t startVersion = this->structureVersion;
+    size_t merged = 0;
+    bool hintsValid = true;
+    //keys are merged in order so the last merged key sits between a later key and its buffered predecessor
+    AVLNode* lastMerged = nullptr;
+
+    for (BufferedInsert& entry : entries) {
+        //anything besides our own inserts (such as an eviction) may have freed a hinted node
+        if (this->structureVersion != startVersion + merged) {
+            hintsValid = false;
+        }
+
+        AVLNode* predecessor;
+        if (entry.hinted and hintsValid and entry.structureVersion == startVersion) {
+            predecessor = entry.predecessor;
+            if (lastMerged != nullptr and (predecessor == nullptr or lastMerged->key > predecessor->key)) {
+                predecessor = lastMerged;
+            }
+        }
+        else {
+            //the last merged key is still in the tree and just below this one, so the search starts near it
+            bool found = false;
+            predecessor = findOrPredecessor(entry.key, searchStart(lastMerged, entry.key), found);
+            if (found) {
+                continue;
+            }
+        }
+        AVLNode* node = insertAfter(predecessor, entry.key, entry.value);
+        merged++;
+        lastMerged = node;
+        finishInsert(node);
+    }
+}
+
+/*
+ *  bufferInsert - insert through the write buffer. When the filter rules key out it can not be in the tree and no
+ *      descent is made, otherwise the key is checked against the tree with one read only descent that also
+ *      remembers its predecessor for the merge
+ *
+ *  params
+ *      key - key being inserted
+ *      value - value to store
+ *
+ *  returns - true if key was new, false if it is buffered or in the tree already
+ */
+bool AVLTree::bufferInsert(const std::string &key, size_t value) {
+    size_t position = bufferPosition(key);
+    if (position < this->writeBuffer.size() and this->writeBuffer[position].key == key) {
+        return false;
+    }
+    bool found = false;
+    bool hinted = !filterRejects(key);
+    AVLNode* node = hinted ? findOrPredecessor(key, this->root, found) : nullptr;
+    //an expired key is replaced in place rather than buffered next to it
+    if (found and isExpired(node)) {
+        std::string newKey = key;
+        bool inserted = false;
+        emplaceNode(newKey, value, inserted);
+        return inserted;
+    }
+    if (found) {
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (this->writeBuffer.empty()) {
+        this->writeBufferOldest = now;
+    }
+    this->writeBuffer.insert(this->writeBuffer.begin() + position, {key, value, node, hinted, this->structureVersion});
+
+    if (this->writeBuffer.size() >= this->writeBufferLimit or
+        (this->writeBufferMaxAge.count() != 0 and now - this->writeBufferOldest >= this->writeBufferMaxAge)) {
+        flushWriteBuffer();
+    }
+    return true;
+}
+
+/*
+ *  findOrPredecessor - walk down from start looking for key, remembering the last node passed on the right
+ *
+ *  params
+ *      key - key being searched for
+ *      start - root or a subtree that holds the place of key along with a smaller key
+ *      found - set to true if key is in the tree
+ *
+ *  returns - the node holding key, or the node with the largest key less than key (nullptr if there is none)
+ */
+AVLTree::AVLNode* AVLTree::findOrPredecessor(const std::string &key, AVLNode *start, bool &found) const {
+    AVLNode* predecessor = nullptr;
+    AVLNode* curNode = start;
+    while (curNode != nullptr) {
+        int compare = key.compare(curNode->key);
+        if (compare == 0) {
+            found = true;
+            return curNode;
+        }
+        if (compare > 0) {
+            predecessor = curNode;
+            curNode = curNode->right;
+        }
+        else {
+            curNode = curNode->left;
+        }
+    }
+    found = false;
+    return predecessor;
+}
+
+/*
+ *  searchStart - climb from a node with a smaller key than key to the lowest subtree that must hold the place of
+ *      key. A left child only holds keys below its parent, so the climb stops at one whose parent is above key
+ *
+ *  params
+ *      node - node with a key less than key, nullptr to start from the root
+ *      key - key being placed
+ *
+ *  returns - top of the subtree to search from
+ */
+AVLTree::AVLNode* AVLTree::searchStart(AVLNode *node, const std::string &key) const {
+    if (node == nullptr) {
+        return this->root;
+    }
+    while (node->parent != nullptr and !(node->parent->left == node and key < node->parent->key)) {
+        node = node->parent;
+    }
+    return node;
+}
+
+/*
+ *  insertAfter - link a new node for key into the spot right after predecessor in key order and balance upward.
+ *      That spot is predecessors right link when empty, otherwise the left link of its successor
+ *
+ *  params
+ *      predecessor - node with the next smaller key, nullptr to insert before every key
+ *      key - key moved into the new node
+ *      value - value of the new node
+ *
+ *  returns - the new node
+ */
+AVLTree::AVLNode* AVLTree::insertAfter(AVLNode *predecessor, std::string &key, size_t value) {
+    AVLNode* parent;
+    bool leftSide;
+    if (predecessor != nullptr and predecessor->right == nullptr) {
+        parent = predecessor;
+        leftSide = false;
+    }
+    else {
+        //successor is the leftmost node right of predecessor, or of the whole tree
+        parent = (predecessor != nullptr) ? predecessor->right : this->root;
+        while (parent != nullptr and parent->left != nullptr) {
+            parent = parent->left;
+        }
+        leftSide = true;
+    }
+
+    AVLNode* node = new AVLNode(std::move(key), value, parent);
+    if (parent == nullptr) {
+        this->root = node;
+    }
+    else if (leftSide) {
+        parent->left = node;
+    }
+    else {
+        parent->right = node;
+    }
+    linkNode(node);
+
+    //WAVL fixes ranks itself in finishInsert, it only needs aggregates brought up to date first
+    if (this->balancePolicy == BalancePolicy::WAVL) {
+        refreshAggregates(parent);
+    }
+    else {
+        rebalanceUpward(parent);
+    }
+    return node;
+}
+
+/*
+ *  rebalanceUpward - update and balance each node from node to the root. Without aggregates this stops at the first
+ *      subtree whose height did not change since nothing above it can change either
+ *
+ *  params
+ *      node - lowest node that may need updating
+ */
+void AVLTree::rebalanceUpward(AVLNode *node) {
+    bool aggregates = static_cast<bool>(this->aggregateFunction.combine);
+    while (node != nullptr) {
+        size_t oldHeight = node->height;
+        AVLNode* parent = node->parent;
+        updateNode(node);
+
+        //balance through the link that points at node so rotations update it
+        AVLNode*& link = (parent == nullptr) ? this->root : ((parent->left == node) ? parent->left : parent->right);
+        balanceNode(link);
+
+        if (!aggregates and link->height == oldHeight) {
+            return;
+        }
+        node = parent;
+    }
+}
+
+/*
+ *  bufferPosition - binary search of the write buffer
+ *
+ *  returns - index of the first buffered key not less than key
+ */
+size_t AVLTree::bufferPosition(const std::string &key) const {
+    auto position = std::lower_bound(this->writeBuffer.begin(), this->writeBuffer.end(), key,
+        [](const BufferedInsert& entry, const std::string& searchKey) {
+            return entry.key < searchKey;
+        });
+    return position - this->writeBuffer.begin();
+}
+
+/*
+ *  bufferedValue - look key up in the write buffer
+ *
+ *  returns - pointer to the buffered value or nullptr if key is not buffered
+ */
+const size_t* AVLTree::bufferedValue(const std::string &key) const {
+    if (this->writeBuffer.empty()) {
+        return nullptr;
+    }
+    size_t position = bufferPosition(key);
+    if (position < this->writeBuffer.size() and this->writeBuffer[position].key == key) {
+        return &this->writeBuffer[position].value;
+    }
+    return nullptr;
+}
+
+/*
+ *  flushIfBuffered - calls that hand out or change a value in place need the key to be a node, so the buffer is
+ *      merged first if key is in it
+ *
+ *  params
+ *      key - key about to be changed
+ */
+void AVLTree::flushIfBuffered(const std::string &key) {
+    if (bufferedValue(key) != nullptr) {
+        flushWriteBuffer();
+    }
+}
+
+/*
+ *  markDirty - record that node changed since the last checkpoint. Ancestors are flagged until one already is so
+ *      writeCheckpoint only walks down into subtrees holding changes
+ *
+ *  params
+ *      node - node that was added or had its value changed
+ */
+void AVLTree::markDirty(AVLNode *node) {
+    if (!this->checkpointing) {
+        return;
+    }
+    node->dirty = true;
+    while (node != nullptr and !node->subtreeDirty) {
+        node->subtreeDirty = true;
+        node = node->parent;
+    }
+}
+
+/*
+ *  writeSnapshot - write every key and value in key order. Later checkpoints are deltas on top of this one
+ *
+ *  params
+ *      os - stream to write to
+ *
+ *  returns - false if the stream failed
+ */
+bool AVLTree::writeSnapshot(std::ostream &os) {
+    flushWriteBuffer();
+    writeCheckpointHeader(os, {true, this->checkpointSequence, this->checkpointSequence + 1});
+    writeVarint(os, 0);
+    writeVarint(os, this->treeSize);
+    snapshotHelper(this->root, os, true);
+
+    this->checkpointSequence++;
+    this->checkpointing = true;
+    this->removedKeys.clear();
+    return os.good();
+}
+
+/*
+ *  writeCheckpoint - write the keys removed since the last checkpoint and then the dirty nodes, so the size of the
+ *      delta follows the number of changes instead of the size of the tree. Without a base to build on a full
+ *      snapshot is written instead
+ *
+ *  params
+ *      os - stream to write to
+ *
+ *  returns - false if the stream failed
+ */
+bool AVLTree::writeCheckpoint(std::ostream &os) {
+    if (!this->checkpointing) {
+        return writeSnapshot(os);
+    }
+    flushWriteBuffer();
+
+    //a key removed more than once only needs one entry
+    std::sort(this->removedKeys.begin(), this->removedKeys.end());
+    this->removedKeys.erase(std::unique(this->removedKeys.begin(), this->removedKeys.end()), this->removedKeys.end());
+    std::vector<AVLNode*> dirtyNodes;
+    collectDirty(this->root, dirtyNodes);
+
+    writeCheckpointHeader(os, {false, this->checkpointSequence, this->checkpointSequence + 1});
+    writeVarint(os, this->removedKeys.size());
+    for (const std::string& key : this->removedKeys) {
+        writeString(os, key);
+    }
+    writeVarint(os, dirtyNodes.size());
+    for (AVLNode* node : dirtyNodes) {
+        writeString(os, node->key);
+        writeVarint(os, node->value);
+    }
+
+    this->checkpointSequence++;
+    this->removedKeys.clear();
+    return os.good();
+}
+
+/*
+ *  applyCheckpoint - replace the tree with a snapshot or apply a delta on top of it. A delta is only applied if it
+ *      was written right after the last checkpoint this tree wrote or applied. Applied changes are not dirty, the
+ *      tree matches the checkpoint afterwards
+ *
+ *  params
+ *      is - stream holding the checkpoint
+ *
+ *  returns - false if is does not hold a checkpoint that can be applied here or is cut short
+ */
+bool AVLTree::applyCheckpoint(std::istream &is) {
+    CheckpointHeader header;
+    if (!readCheckpointHeader(is, header)) {
+        return false;
+    }
+    if (!header.snapshot and (!this->checkpointing or header.baseSequence != this->checkpointSequence)) {
+        return false;
+    }
+
+    //read the whole body first so a checkpoint that is cut short leaves the tree as it was
+    std::vector<std::string> removes;
+    std::vector<std::pair<std::string, size_t>> puts;
+    bool complete = readCheckpointBody(is,
+        [&removes](std::string& key) {
+            removes.push_back(std::move(key));
+        },
+        [&puts](std::string& key, size_t value) {
+            puts.emplace_back(std::move(key), value);
+        });
+    if (!complete) {
+        return false;
+    }
+
+    flushWriteBuffer();
+    if (header.snapshot) {
+        clear();
+    }
+    //keep the changes being applied from being tracked as new ones
+    this->checkpointing = false;
+    for (const std::string& key : removes) {
+        removeKey(key);
+    }
+    for (auto& [key, value] : puts) {
+        insert_or_assign(std::move(key), value);
+    }
+
+    this->checkpointing = true;
+    this->checkpointSequence = header.sequence;
+    this->removedKeys.clear();
+    return true;
+}
+
+/*
+ *  compactCheckpoints - layer a chain of checkpoints into one. Starting from a snapshot gives a new snapshot,
+ *      starting from a delta gives one delta covering the whole chain. A later snapshot in the chain replaces
+ *      everything before it
+ *
+ *  params
+ *      inputs - checkpoints in the order they were written, each following the one before
+ *      out - stream to write the merged checkpoint to
+ *
+ *  returns - false if an input is not a checkpoint, does not follow the one before or is cut short
+ */
+bool AVLTree::compactCheckpoints(std::span<std::istream* const> inputs, std::ostream &out) {
+    if (inputs.empty()) {
+        return false;
+    }
+
+    //latest value of every key still present and, for deltas, every key whose last change was a removal
+    AVLTree puts;
+    AVLTree removes;
+    CheckpointHeader merged{false, 0, 0};
+    for (size_t i = 0; i < inputs.size(); i++) {
+        CheckpointHeader header;
+        if (!readCheckpointHeader(*inputs[i], header)) {
+            return false;
+        }
+        if (i == 0 or header.snapshot) {
+            merged.snapshot = merged.snapshot or header.snapshot;
+            merged.baseSequence = header.baseSequence;
+            puts.clear();
+            removes.clear();
+        }
+        else if (header.baseSequence != merged.sequence) {
+            return false;
+        }
+        merged.sequence = header.sequence;
+
+        bool snapshot = merged.snapshot;
+        bool complete = readCheckpointBody(*inputs[i],
+            [&](std::string& key) {
+                puts.removeKey(key);
+                //a snapshot has nothing underneath that the removal still has to reach
+                if (!snapshot) {
+                    removes.insert_or_assign(std::move(key), 0);
+                }
+            },
+            [&](std::string& key, size_t value) {
+                puts.insert_or_assign(std::move(key), value);
+            });
+        if (!complete) {
+            return false;
+        }
+    }
+
+    writeCheckpointHeader(out, merged);
+    writeVarint(out, removes.size());
+    removes.snapshotHelper(removes.root, out, false);
+    writeVarint(out, puts.size());
+    puts.snapshotHelper(puts.root, out, true);
+    return out.good();
+}
+
+/*
+ *  snapshotHelper - in order walk writing each key (and value) and clearing dirty flags on the way
+ *
+ *  params
+ *      curNode - top of the subtree being written
+ *      os - stream to write to
+ *      withValues - false to write only the keys
+ */
+void AVLTree::snapshotHelper(AVLNode *curNode, std::ostream &os, bool withValues) {
+    if (curNode == nullptr) {
+        return;
+    }
+    snapshotHelper(curNode->left, os, withValues);
+    writeString(os, curNode->key);
+    if (withValues) {
+        writeVarint(os, curNode->value);
+    }
+    curNode->dirty = false;
+    curNode->subtreeDirty = false;
+    snapshotHelper(curNode->right, os, withValues);
+}
+
+/*
+ *  collectDirty - in order walk that skips every subtree without changes
+ *
+ *  params
+ *      curNode - top of the subtree being searched
+ *      dirtyNodes - dirty nodes are added here in key order
+ */
+void AVLTree::collectDirty(AVLNode *curNode, std::vector<AVLNode*> &dirtyNodes) {
+    if (curNode == nullptr or !curNode->subtreeDirty) {
+        return;
+    }
+    collectDirty(curNode->left, dirtyNodes);
+    if (curNode->dirty) {
+        dirtyNodes.push_back(curNode);
+    }
+    curNode->dirty = false;
+    curNode->subtreeDirty = false;
+    collectDirty(curNode->right, dirtyNodes);
+}
+
+/*
+ *  writeCheckpointHeader - magic, version, kind byte then the base and own sequence numbers
+ */
+void AVLTree::writeCheckpointHeader(std::ostream &os, const CheckpointHeader &header) {
+    os.write(checkpointMagic, sizeof(checkpointMagic));
+    os.put(checkpointVersion);
+    os.put(header.snapshot ? 1 : 0);
+    writeVarint(os, header.baseSequence);
+    writeVarint(os, header.sequence);
+}
+
+/*
+ *  readCheckpointHeader - read a header written by writeCheckpointHeader
+ *
+ *  returns - false if is does not start with a checkpoint header this version understands
+ */
+bool AVLTree::readCheckpointHeader(std::istream &is, CheckpointHeader &header) {
+    char magic[sizeof(checkpointMagic) + 2];
+    is.read(magic, sizeof(magic));
+    if (is.gcount() != sizeof(magic) or
+        std::char_traits<char>::compare(magic, checkpointMagic, sizeof(checkpointMagic)) != 0 or
+        magic[sizeof(checkpointMagic)] != checkpointVersion or magic[sizeof(checkpointMagic) + 1] > 1) {
+        return false;
+    }
+    header.snapshot = magic[sizeof(checkpointMagic) + 1] == 1;
+    return readVarint(is, header.baseSequence) and readVarint(is, header.sequence);
+}
+
+/*
+ *  readCheckpointBody - read the removed keys and then the changed keys and values of a checkpoint
+ *
+ *  params
+ *      is - stream positioned after the header
+ *      onRemove - called with each removed key
+ *      onPut - called with each changed key and its value
+ *
+ *  returns - false if the stream ended early
+ */
+bool AVLTree::readCheckpointBody(std::istream &is, const std::function<void(std::string&)> &onRemove,
+                                 const std::function<void(std::string&, size_t)> &onPut) {
+    uint64_t count;
+    std::string key;
+    if (!readVarint(is, count)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        if (!readString(is, key)) {
+            return false;
+        }
+        onRemove(key);
+    }
+
+    if (!readVarint(is, count)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t value;
+        if (!readString(is, key) or !readVarint(is, value)) {
+            return false;
+        }
+        onPut(key, value);
+    }
+    return true;
+}
+
+/*
+ *  setLatencySampling - turn per call timing on or off. Histograms are kept until timing is turned off, changing
+ *      the rate keeps what was already recorded
+ *
+ *  params
+ *      sampleEvery - time one call in this many, 0 turns timing off
+ */
+void AVLTree::setLatencySampling(size_t sampleEvery) {
+    if (sampleEvery == 0) {
+        delete[] this->latencyHistograms;
+        this->latencyHistograms = nullptr;
+        return;
+    }
+    if (this->latencyHistograms == nullptr) {
+        this->latencyHistograms = new LatencyHistogram[timedOpCount];
+    }
+    for (size_t op = 0; op < timedOpCount; op++) {
+        this->latencyHistograms[op].setSampleEvery(sampleEvery);
+    }
+}
+
+/*
+ *  latencySnapshot - merged latencies of op for an exporter
+ *
+ *  params
+ *      op - which call
+ *      reset - start a new interval for op after this snapshot
+ *
+ *  returns - the histogram, with no counts while timing is off
+ */
+LatencySnapshot AVLTree::latencySnapshot(TimedOp op, bool reset) const {
+    LatencyHistogram* histogram = latencyHistogram(op);
+    if (histogram == nullptr) {
+        return LatencySnapshot{};
+    }
+    return histogram->snapshot(reset);
+}
+
+/*
+ *  latencyHistogram - histogram op is timed into, nullptr while timing is off so the timer does nothing
+ */
+LatencyHistogram* AVLTree::latencyHistogram(TimedOp op) const {
+    if (this->latencyHistograms == nullptr) {
+        return nullptr;
+    }
+    return &this->latencyHistograms[static_cast<size_t>(op)];
+}
+
+/*
+ *  compact - move every node into contiguous blocks in one go
+ */
+void AVLTree::compact() {
+    startCompaction();
+    compactStep(SIZE_MAX);
+}
+
+/*
+ *  startCompaction - plan the new node order. The nodes are moved by compactStep, a running compaction is dropped
+ *      first with whatever it already moved kept in place
+ */
+void AVLTree::startCompaction() {
+    finishCompaction();
+    this->compactionGeneration++;
+    this->compactionActive = true;
+    planCompaction();
+}
+
+/*
+ *  compactStep - move the next planned nodes. Inserted nodes are left where they are, a removal since the last step
+ *      makes the step plan again over the nodes not moved yet
+ *
+ *  params
+ *      maxNodes - most nodes to move in this call
+ *
+ *  returns - true once no compaction is left to run
+ */
+bool AVLTree::compactStep(size_t maxNodes) {
+    if (!this->compactionActive) {
+        return true;
+    }
+    if (this->compactionStale) {
+        planCompaction();
+    }
+
+    size_t moved = 0;
+    while (moved < maxNodes and this->compactionNext < this->compactionPlan.size()) {
+        relocateNode(this->compactionPlan[this->compactionNext]);
+        this->compactionNext++;
+        moved++;
+    }
+    //buffered predecessor hints may point at moved nodes
+    if (moved != 0) {
+        this->structureVersion++;
+    }
+
+    if (this->compactionNext == this->compactionPlan.size()) {
+        finishCompaction();
+        return true;
+    }
+    return false;
+}
+
+/*
+ *  compactionPending - true while a compaction started by startCompaction has nodes left to move
+ */
+bool AVLTree::compactionPending() const {
+    return this->compactionActive;
+}
+
+/*
+ *  compactionTopLevels - how many levels are laid out breadth first, as many as fit in one block so the first
+ *      hops of every lookup share a few pages
+ */
+size_t AVLTree::compactionTopLevels() const {
+    size_t levels = 1;
+    while ((size_t{2} << levels) - 1 <= nodesPerBlock()) {
+        levels++;
+    }
+    return levels;
+}
 
-    //need to balance node
-    if (balance == -2) {
-        //Look at right nodes balance
-        AVLNode* rightNode = node->right;
-        int rightNodeBalance = rightNode->getBalance();
+/*
+ *  nodeBlockOffset - where the first node starts after the block header
+ */
+size_t AVLTree::nodeBlockOffset() {
+    return (sizeof(NodeBlock) + alignof(AVLNode) - 1) / alignof(AVLNode) * alignof(AVLNode);
+}
 
-        //right then left rotate
-        if (rightNodeBalance == 1) {
-            AVLNode* origRightLeft = rightNode->left;
+/*
+ *  nodesPerBlock - node slots in each block
+ */
+size_t AVLTree::nodesPerBlock() {
+    return (nodeBlockBytes - nodeBlockOffset()) / sizeof(AVLNode);
+}
 
-            if ((node->left != nullptr) and (node->left->right != nullptr)) {
-                node->right = node->left->right;
-            }
-            else {
-                node->right = nullptr;
-            }
+/*
+ *  planCompaction - order the nodes for the new layout: the top levels breadth first, then each subtree hanging
+ *      below them depth first (preorder) so a walk down that subtree stays within a few neighbouring lines. Nodes
+ *      this compaction already moved are skipped but still walked through
+ */
+void AVLTree::planCompaction() {
+    this->compactionPlan.clear();
+    this->compactionNext = 0;
+    this->compactionStale = false;
+    if (this->root == nullptr) {
+        return;
+    }
 
-            //Set node height to the greater of its two childrens heights + 1
-            if (node->right->getHeight() > node->left->getHeight()) {
-                node->height = node->right->getHeight() + 1;
-            } else {
-                node->height = node->left->getHeight() + 1;
+    std::vector<AVLNode*> level{this->root};
+    size_t topLevels = compactionTopLevels();
+    for (size_t depth = 0; depth < topLevels and !level.empty(); depth++) {
+        std::vector<AVLNode*> nextLevel;
+        for (AVLNode* node : level) {
+            if (!placedByCompaction(node)) {
+                this->compactionPlan.push_back(node);
             }
-
-            // node->right = nullptr;
-            // node->height = 0;
-            rightNode->left = origRightLeft->right;
-            if (rightNode->left != nullptr) {
-                rightNode->left->parent = rightNode;
+            if (node->left != nullptr) {
+                nextLevel.push_back(node->left);
             }
-
-            //Set orig right lefts height to the greater of its two childrens heights + 1
-            if (rightNode->right->getHeight() > rightNode->left->getHeight()) {
-                rightNode->height = rightNode->right->getHeight() + 1;
-            } else {
-                rightNode->height = rightNode->left->getHeight() + 1;
+            if (node->right != nullptr) {
+                nextLevel.push_back(node->right);
             }
+        }
+        level.swap(nextLevel);
+    }
 
-            origRightLeft->right = rightNode;
-            origRightLeft->left = node;
-            if (node == root) {
-                root = origRightLeft;
-                origRightLeft->parent = nullptr;
-                node->parent = origRightLeft;
+    //level now holds the roots of the subtrees below the top, left to right
+    std::vector<AVLNode*> pending;
+    for (AVLNode* subtree : level) {
+        pending.push_back(subtree);
+        while (!pending.empty()) {
+            AVLNode* node = pending.back();
+            pending.pop_back();
+            if (!placedByCompaction(node)) {
+                this->compactionPlan.push_back(node);
             }
-            else {
-                origRightLeft->parent = node->parent;
-                node->parent->right = origRightLeft;
-                node->parent = origRightLeft;
+            if (node->right != nullptr) {
+                pending.push_back(node->right);
             }
-
-            //Set orig right lefts height to the greater of its two childrens heights + 1
-            if (origRightLeft->right->getHeight() > origRightLeft->left->getHeight()) {
-                origRightLeft->height = origRightLeft->right->getHeight() + 1;
-            } else  if (origRightLeft->left->getHeight() > origRightLeft->right->getHeight()){
-                origRightLeft->height = origRightLeft->left->getHeight() + 1;
-            }   else {
-                node->height = 0;
+            if (node->left != nullptr) {
+                pending.push_back(node->left);
             }
         }
-        //left rotate
-        else if (rightNodeBalance == -1) {
-            //Set parent of node to the right node and rotate the rightNodes left node around pivot node
-            node->parent = rightNode;
-            node->right = rightNode->left;
-
-            //Set node height to the greater of its two childrens heights + 1
-            if (node->right->getHeight() > node->left->getHeight()) {
-                node->height = node->right->getHeight() + 1;
-            } else if (node->left->getHeight() > node->right->getHeight()) {
-                node->height = node->left->getHeight() + 1;
-            }
-            else {
-                node->height = 0;
-            }
+    }
+}
 
-            //set root nood properly if it has changed
-            if (node == root) {
-                root = rightNode;
-                rightNode->parent = nullptr;
-                rightNode->left = node;
-                node->parent = rightNode;
-            }
-            else {
-                rightNode->left = node;
-                rightNode->parent = node->parent;
-                node->parent->left = rightNode;
-                node->parent = rightNode;
-            }
+/*
+ *  relocateNode - move a node into the next slot of the block being filled. Its parent, children and recency list
+ *      neighbours are pointed at the new copy and the old one is freed
+ *
+ *  params
+ *      old - node to move
+ *
+ *  returns - the node at its new address
+ */
+AVLTree::AVLNode* AVLTree::relocateNode(AVLNode *old) {
+    if (this->compactionBlock == nullptr or this->compactionBlockUsed == nodesPerBlock()) {
+        if (this->compactionBlock != nullptr) {
+            releaseBlock(this->compactionBlock);
         }
+        void* memory = ::operator new(nodeBlockBytes, std::align_val_t(nodeBlockBytes));
+        this->compactionBlock = new (memory) NodeBlock;
+        //the extra count keeps the block alive while it is still being filled
+        this->compactionBlock->liveNodes.store(1, std::memory_order_relaxed);
+        this->compactionBlock->generation = this->compactionGeneration;
+        this->compactionBlockUsed = 0;
     }
-    else if (balance == 2) {
-        AVLNode* leftNode = node->left;
-        int leftNodeBalance = leftNode->getBalance();
 
-        //left then right rotate
-        if (leftNodeBalance == -1) {
-            AVLNode* origLeftRight = leftNode->right;
+    char* slot = reinterpret_cast<char*>(this->compactionBlock) + nodeBlockOffset() +
+                 this->compactionBlockUsed * sizeof(AVLNode);
+    this->compactionBlockUsed++;
+    this->compactionBlock->liveNodes.fetch_add(1, std::memory_order_relaxed);
+
+    AVLNode* node = new (slot) AVLNode(std::move(old->key), old->value, old->parent);
+    node->height = old->height;
+    node->aggregate = old->aggregate;
+    node->usePrev = old->usePrev;
+    node->useNext = old->useNext;
+    node->referenced = old->referenced;
+    node->dirty = old->dirty;
+    node->subtreeDirty = old->subtreeDirty;
+    node->left = old->left;
+    node->right = old->right;
+    node->inArena = true;
+    node->expiresAt = old->expiresAt;
+
+    replaceChild(node->parent, old, node);
+    if (node->left != nullptr) {
+        node->left->parent = node;
+    }
+    if (node->right != nullptr) {
+        node->right->parent = node;
+    }
+    if (node->usePrev != nullptr) {
+        node->usePrev->useNext = node;
+    }
+    else if (this->recencyHead == old) {
+        this->recencyHead = node;
+    }
+    if (node->useNext != nullptr) {
+        node->useNext->usePrev = node;
+    }
+    else if (this->recencyTail == old) {
+        this->recencyTail = node;
+    }
+    if (this->clockHand == old) {
+        this->clockHand = node;
+    }
 
-            //Set the current node to bottom left of tree branch
-            if ((node->right != nullptr) and (node->right->left != nullptr) ){
-                node->left = node->right->left;
-            }
-            else {
-                node->left = nullptr;
-            }
-            node->height = node->right->getHeight() + 1;
+    freeNode(old);
+    return node;
+}
 
-            //Set previous left node to be rotated into place of origLeftRight
-            leftNode->right = origLeftRight->left;
+/*
+ *  finishCompaction - drop the plan and let go of the block being filled
+ */
+void AVLTree::finishCompaction() {
+    if (this->compactionBlock != nullptr) {
+        releaseBlock(this->compactionBlock);
+        this->compactionBlock = nullptr;
+    }
+    std::vector<AVLNode*>().swap(this->compactionPlan);
+    this->compactionNext = 0;
+    this->compactionActive = false;
+    this->compactionStale = false;
+}
 
-            if (leftNode->right != nullptr) {
-                leftNode->right->parent = leftNode;
-            }
+/*
+ *  placedByCompaction - true if node was already moved by the running compaction
+ */
+bool AVLTree::placedByCompaction(const AVLNode *node) const {
+    return node->inArena and blockOf(node)->generation == this->compactionGeneration;
+}
 
-            //Set left nodes height to be 1 greater than the greateast height between its children
-            if (leftNode->right->getHeight() > leftNode->left->getHeight()) {
-                leftNode->height = leftNode->right->getHeight() + 1;
-            } else {
-                leftNode->height = leftNode->left->getHeight() + 1;
-            }
+/*
+ *  blockOf - blocks are aligned to their size so the block of a node is its address rounded down
+ */
+AVLTree::NodeBlock* AVLTree::blockOf(const AVLNode *node) {
+    return reinterpret_cast<NodeBlock*>(reinterpret_cast<uintptr_t>(node) & ~static_cast<uintptr_t>(nodeBlockBytes - 1));
+}
 
-            //OrigLeftRight should be in place of node as head of tree segment
-            origLeftRight->left = leftNode;
-            origLeftRight->right = node;
+/*
+ *  releaseBlock - drop one count from a block and free it after its last node. Nodes can be freed by the background
+ *      reclaimer so the count is atomic
+ */
+void AVLTree::releaseBlock(NodeBlock *block) {
+    if (block->liveNodes.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        block->~NodeBlock();
+        ::operator delete(block, std::align_val_t(nodeBlockBytes));
+    }
+}
 
-            if (node == root) {
-                root = origLeftRight;
-                origLeftRight->parent = nullptr;
-                node->parent = origLeftRight;
-            }
-            else {
-                origLeftRight->parent = node->parent;
-                node->parent->left = origLeftRight;
-                node->parent = origLeftRight;
-            }
+/*
+ *  freeNode - delete a node allocated by new or destroy one in a block and release the block
+ */
+void AVLTree::freeNode(AVLNode *node) {
+    if (!node->inArena) {
+        delete node;
+        return;
+    }
+    NodeBlock* block = blockOf(node);
+    node->~AVLNode();
+    releaseBlock(block);
+}
+
+/*
+ *  setFilter - build a filter over the current keys, replacing any earlier one
+ *
+ *  params
+ *      expectedKeys - keys the filter is sized for, raised to the current size. 0 drops the filter
+ *      falsePositiveRate - target fraction of absent keys the filter lets through, kept for later rebuilds
+ */
+void AVLTree::setFilter(size_t expectedKeys, double falsePositiveRate) {
+    delete this->filter;
+    this->filter = nullptr;
+    this->filterRejected = 0;
+    this->filterFalsePositives = 0;
+    if (expectedKeys == 0) {
+        return;
+    }
+    this->filterFalsePositiveRate = falsePositiveRate;
+    rebuildFilter(std::max(expectedKeys, this->treeSize));
+}
+
+/*
+ *  filterStats - size of the filter and how well it has done since setFilter
+ */
+AVLTree::FilterStats AVLTree::filterStats() const {
+    FilterStats stats;
+    if (this->filter == nullptr) {
+        return stats;
+    }
+    stats.bytes = this->filter->bytes();
+    stats.capacity = this->filter->capacity();
+    stats.rejected = this->filterRejected.load(std::memory_order_relaxed);
+    stats.falsePositives = this->filterFalsePositives.load(std::memory_order_relaxed);
+    stats.expectedFalsePositiveRate = this->filter->expectedFalsePositiveRate();
+    size_t absentLookups = stats.rejected + stats.falsePositives;
+    if (absentLookups != 0) {
+        stats.observedFalsePositiveRate = static_cast<double>(stats.falsePositives) / static_cast<double>(absentLookups);
+    }
+    return stats;
+}
+
+/*
+ *  filterRejects - check key against the filter before a descent
+ *
+ *  params
+ *      key  - key about to be searched for
+ *
+ *  returns - true if key is definitely not in the tree
+ */
+bool AVLTree::filterRejects(const std::string &key) const {
+    if (this->filter == nullptr or this->filter->mayContain(key)) {
+        return false;
+    }
+    this->filterRejected.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/*
+ *  filterMissed - a descent the filter allowed found nothing
+ */
+void AVLTree::filterMissed() const {
+    if (this->filter != nullptr) {
+        this->filterFalsePositives.fetch_add(1, std::memory_order_relaxed);
+    }
+}
 
-            //Set orig left rights height to the greater of its two childrens heights + 1
-            if (origLeftRight->right->getHeight() > origLeftRight->left->getHeight()) {
-                origLeftRight->height = origLeftRight->right->getHeight() + 1;
-            } else {
-                origLeftRight->height = origLeftRight->left->getHeight() + 1;
+/*
+ *  rebuildFilter - replace the filter with one sized for expectedKeys holding every key in the tree. Rebuilding
+ *      also resets counters that saturated
+ */
+void AVLTree::rebuildFilter(size_t expectedKeys) {
+    delete this->filter;
+    this->filter = new CountingBloomFilter(expectedKeys, this->filterFalsePositiveRate);
+    filterHelper(this->root);
+}
+
+/*
+ *  filterHelper - recursive helper that adds every key below curNode to the filter
+ */
+void AVLTree::filterHelper(AVLNode *curNode) {
+    if (curNode == nullptr) {
+        return;
+    }
+    this->filter->add(curNode->key);
+    filterHelper(curNode->left);
+    filterHelper(curNode->right);
+}
+
+/*
+ *  setChangeFeed - start, resize or stop the changefeed. Starting it again starts a new log, followers from
+ *      before have to be copied afresh. Changes made while the feed was off are not logged, so a restart takes a
+ *      sequence number of its own and every follower from before falls behind the dropped changes
+ *
+ *  params
+ *      maxEvents - changes kept for followers, older ones are dropped. 0 stops the feed and drops the log
+ *      coalesce - keep only the newest change of each key so a follower that is far behind reads at most one
+ *          change per key
+ */
+void AVLTree::setChangeFeed(size_t maxEvents, bool coalesce) {
+    bool restart = this->changeLogLimit == 0 or maxEvents == 0 or coalesce != this->changeCoalesce;
+    this->changeLogLimit = maxEvents;
+    this->changeCoalesce = coalesce;
+    if (restart) {
+        this->changeLog.clear();
+        this->latestChange.clear();
+        this->supersededChanges = 0;
+        this->changeSequenceNumber++;
+        this->changesDroppedThrough = this->changeSequenceNumber;
+    }
+    trimChangeLog();
+}
+
+/*
+ *  changeSequence - returns the sequence of the newest change, 0 if there has been none
+ */
+uint64_t AVLTree::changeSequence() const {
+    return this->changeSequenceNumber;
+}
+
+/*
+ *  readChanges - copy the changes a follower has not applied yet
+ *
+ *  params
+ *      afterSequence - newest change the follower has applied
+ *      maxEvents - most changes to append
+ *      out - changes are appended here, oldest first
+ *
+ *  returns - false if the feed is off or the changes right after afterSequence are no longer kept
+ */
+bool AVLTree::readChanges(uint64_t afterSequence, size_t maxEvents, std::vector<ChangeEvent> &out) const {
+    if (this->changeLogLimit == 0 or afterSequence < this->changesDroppedThrough or
+        afterSequence > this->changeSequenceNumber) {
+        return false;
+    }
+
+    auto first = std::upper_bound(this->changeLog.begin(), this->changeLog.end(), afterSequence,
+        [](uint64_t sequence, const LoggedChange& change) {
+            return sequence < change.event.sequence;
+        });
+    size_t added = 0;
+    for (auto change = first; change != this->changeLog.end() and added < maxEvents; ++change) {
+        if (change->superseded) {
+            continue;
+        }
+        out.push_back(change->event);
+        if (change->valueByReference) {
+            AVLNode* node = getNodePlace(change->event.key, this->root);
+            if (node != nullptr) {
+                out.back().value = node->value;
             }
         }
-        //right rotate
-        else if (leftNodeBalance == 1) {
-            RightRotate(node);
+        added++;
+    }
+    return true;
+}
+
+/*
+ *  applyChanges - replay changes from a leader on this tree
+ *
+ *  params
+ *      events - changes from readChanges, oldest first
+ *
+ *  returns - false if the sequences go backwards, the changes before that one are applied
+ */
+bool AVLTree::applyChanges(std::span<const ChangeEvent> events) {
+    for (size_t i = 0; i < events.size(); i++) {
+        const ChangeEvent& event = events[i];
+        if (i != 0 and event.sequence <= events[i - 1].sequence) {
+            return false;
+        }
+        if (event.sequence <= this->appliedSequence) {
+            continue;
+        }
+        switch (event.op) {
+            case ChangeOp::Insert:
+            case ChangeOp::Update:
+                insert_or_assign(event.key, event.value);
+                break;
+            case ChangeOp::Remove:
+                remove(event.key);
+                break;
+            case ChangeOp::Clear:
+                clear();
+                break;
         }
+        this->appliedSequence = event.sequence;
     }
+    return true;
 }
 
-void AVLTree::RightRotate(AVLNode* pivotNode) {
-    AVLNode* leftNode = pivotNode->left;
+/*
+ *  appliedChangeSequence - returns the newest change applied by applyChanges, where a follower resumes from
+ */
+uint64_t AVLTree::appliedChangeSequence() const {
+    return this->appliedSequence;
+}
 
-    if (leftNode->right != nullptr) {
-        pivotNode->left = leftNode->right;
+/*
+ *  recordChange - add a change to the log while the feed is on. In a coalesced feed the last change of the same
+ *      key is marked superseded, and a clear supersedes everything before it
+ *
+ *  params
+ *      op - what changed
+ *      key - key that changed, empty for a clear
+ *      value - new value of an insert or update
+ */
+void AVLTree::recordChange(ChangeOp op, const std::string &key, size_t value) {
+    if (this->changeLogLimit == 0) {
+        return;
     }
-    else {
-        pivotNode->left = nullptr;
+    this->changeSequenceNumber++;
+    if (this->changeCoalesce and op == ChangeOp::Clear) {
+        this->changeLog.clear();
+        this->latestChange.clear();
+        this->supersededChanges = 0;
     }
-
-    //Set pivot nodes height to the greater of its two childrens heights + 1
-    if (pivotNode->right->getHeight() > pivotNode->left->getHeight()) {
-        pivotNode->height = pivotNode->right->getHeight() + 1;
-    } else if (pivotNode->left->getHeight() > pivotNode->right->getHeight()){
-        pivotNode->height = pivotNode->left->getHeight() + 1;
-    } else {
-        pivotNode->height = 0;
+    else if (this->changeCoalesce) {
+        auto [latest, added] = this->latestChange.try_emplace(key, this->changeSequenceNumber);
+        if (!added) {
+            LoggedChange* previous = findChange(latest->second);
+            if (previous != nullptr and !previous->superseded) {
+                previous->superseded = true;
+                this->supersededChanges++;
+            }
+            latest->second = this->changeSequenceNumber;
+        }
     }
+    this->changeLog.push_back({{this->changeSequenceNumber, op, key, value}, false, false});
+    trimChangeLog();
+}
 
-    //adjust pivot and left nodes for new positions
-    leftNode->right = pivotNode;
-    if (pivotNode == this->root) {
-        this->root = leftNode;
-        leftNode->parent = nullptr;
+/*
+ *  recordChangeByReference - a reference to the value of node is being handed out. An update is logged every time
+ *      and flagged to read its value at readChanges time, so a follower that already read an older change of node
+ *      still sees what is written through this reference
+ */
+void AVLTree::recordChangeByReference(const AVLNode *node) {
+    if (this->changeLogLimit == 0) {
+        return;
     }
-    else {
-        leftNode->parent = pivotNode->parent;
-        //set pivots previous parents left to left node
-        pivotNode->parent->left = leftNode;
+    recordChange(ChangeOp::Update, node->key, node->value);
+    this->changeLog.back().valueByReference = true;
+}
+
+/*
+ *  findChange - binary search the log for a sequence number
+ *
+ *  returns - the logged change or nullptr if it was dropped
+ */
+AVLTree::LoggedChange* AVLTree::findChange(uint64_t sequence) {
+    auto change = std::lower_bound(this->changeLog.begin(), this->changeLog.end(), sequence,
+        [](const LoggedChange& logged, uint64_t wanted) {
+            return logged.event.sequence < wanted;
+        });
+    if (change == this->changeLog.end() or change->event.sequence != sequence) {
+        return nullptr;
     }
-    //Set pivot parent to left node
-    pivotNode->parent = leftNode;
+    return &*change;
 }
 
-AVLTree::AVLTree(const AVLTree &other) {
-    if (other.root != nullptr) {
-        this->root = new AVLNode(*other.root, nullptr);
-        copyHelper(other.root, this->root);
-        treeSize = other.treeSize;
+/*
+ *  trimChangeLog - drop live changes from the front past changeLogLimit. Superseded changes at the front go with
+ *      them and once they make up most of the log the rest are taken out too
+ */
+void AVLTree::trimChangeLog() {
+    while (!this->changeLog.empty() and
+           (this->changeLog.front().superseded or this->changeLog.size() - this->supersededChanges > this->changeLogLimit)) {
+        LoggedChange& front = this->changeLog.front();
+        if (front.superseded) {
+            this->supersededChanges--;
+        }
+        else {
+            //a superseded change is covered by the newer one, dropping it leaves no gap for followers
+            this->changesDroppedThrough = front.event.sequence;
+            if (this->changeCoalesce) {
+                this->latestChange.erase(front.event.key);
+            }
+        }
+        this->changeLog.pop_front();
+    }
+
+    if (this->supersededChanges > 64 and this->supersededChanges * 2 > this->changeLog.size()) {
+        std::erase_if(this->changeLog, [](const LoggedChange& change) {
+            return change.superseded;
+        });
+        this->supersededChanges = 0;
     }
 }
 
-bool AVLTree::copyHelper(AVLNode* curNodeOld, AVLNode* curNode) const{
-    if (curNodeOld->getHeight() == 0) {
-        return false;
+/*
+ *  changeHelper - recursive helper that logs an insert for every node below curNode in key order
+ */
+void AVLTree::changeHelper(AVLNode *curNode) {
+    if (curNode == nullptr) {
+        return;
     }
+    changeHelper(curNode->left);
+    recordChange(ChangeOp::Insert, curNode->key, curNode->value);
+    changeHelper(curNode->right);
+}
 
-    if (curNodeOld->left != nullptr) {
-        curNode->left = new AVLNode(*curNodeOld->left);
-        copyHelper(curNodeOld->left, curNode->left);
+/*
+ *  BackgroundReclaimer - one thread shared by every tree that frees detached subtrees. It is joined when the
+ *      program exits after finishing whatever is left
+ */
+class AVLTree::BackgroundReclaimer {
+public:
+    BackgroundReclaimer() {
+        this->stopping = false;
+        this->worker = std::thread([this] { run(); });
     }
 
-    if (curNodeOld->right != nullptr) {
-        curNode->right = new AVLNode(*curNodeOld->right);
-        copyHelper(curNodeOld->right, curNode->right);
+    // once the thread has stopped subtrees are freed right away on the caller
+    void add(AVLNode* subtree) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (this->stopping) {
+            lock.unlock();
+            std::vector<AVLNode*> work = {subtree};
+            freeSubtrees(work, SIZE_MAX);
+            return;
+        }
+        this->pending.push_back(subtree);
+        lock.unlock();
+        this->wake.notify_one();
     }
 
-    return true;
-}
+    // frees whatever is still pending and joins the thread
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (this->stopping) {
+                return;
+            }
+            this->stopping = true;
+        }
+        this->wake.notify_one();
+        this->worker.join();
+    }
 
-void AVLTree::operator=(const AVLTree &other) {
-    deleteHelper(this->root);
-    if (other.root != nullptr) {
-        this->root = new AVLNode(*other.root, nullptr);
-        copyHelper(other.root, this->root);
-        this->treeSize = other.treeSize;
+private:
+    void run() {
+        std::vector<AVLNode*> work;
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true) {
+            this->wake.wait(lock, [this] { return this->stopping or !this->pending.empty(); });
+            if (this->pending.empty() and this->stopping) {
+                return;
+            }
+            work.swap(this->pending);
+            //free without holding the lock so adding never waits on freeing
+            lock.unlock();
+            freeSubtrees(work, SIZE_MAX);
+            lock.lock();
+        }
     }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<AVLNode*> pending;
+    bool stopping;
+    std::thread worker;
+};
+
+/*
+ *  backgroundReclaimer - the shared reclaimer, started the first time it is needed. It is never destroyed since
+ *      trees with static storage can still hand it nodes while the program exits, the thread is stopped and
+ *      joined by an atexit handler instead
+ */
+AVLTree::BackgroundReclaimer& AVLTree::backgroundReclaimer() {
+    static BackgroundReclaimer* reclaimer = [] {
+        BackgroundReclaimer* started = new BackgroundReclaimer();
+        std::atexit([] { backgroundReclaimer().stop(); });
+        return started;
+    }();
+    return *reclaimer;
 }
 
+/*
+ *  AVLTree destructor - frees every node. With background reclaim on the nodes are handed to the background
+ *      thread so destruction does not wait on them
+ */
 AVLTree::~AVLTree() {
+    delete[] this->latencyHistograms;
+    delete this->filter;
+    finishCompaction();
     deleteHelper(this->root);
+    if (this->backgroundReclaim) {
+        for (AVLNode* pending : this->reclaimQueue) {
+            backgroundReclaimer().add(pending);
+        }
+    }
+    else {
+        freeSubtrees(this->reclaimQueue, SIZE_MAX);
+    }
 }
 
-bool AVLTree::deleteHelper(AVLNode* curNode) const{
+/*
+ *  deleteHelper - hand a subtree that is no longer linked into the tree over to be freed later
+ *
+ *  params
+ *      curNode - top of the detached subtree
+ */
+void AVLTree::deleteHelper(AVLNode* curNode) {
     if (curNode == nullptr) {
-        return false;
+        return;
+    }
+    if (this->backgroundReclaim) {
+        backgroundReclaimer().add(curNode);
     }
+    else {
+        this->reclaimQueue.push_back(curNode);
+    }
+}
 
-    if (curNode->left != nullptr) {
-        if (deleteHelper(curNode->left)) {
-            curNode->left = nullptr;
-        }
+/*
+ *  clear - empty the tree in O(1). The old root is detached and its nodes are freed reclaimBatchSize at a time by
+ *      later inserts and removes, by reclaim(), or by the background thread
+ */
+void AVLTree::clear() {
+    finishCompaction();
+    this->structureVersion++;
+    this->writeBuffer.clear();
+    deleteHelper(this->root);
+    this->root = nullptr;
+    this->treeSize = 0;
+    this->treeBytes = 0;
+    this->recencyHead = nullptr;
+    this->recencyTail = nullptr;
+    this->clockHand = nullptr;
+    this->removedParent = nullptr;
+    this->removedChild = nullptr;
+    //the next checkpoint is a full snapshot
+    this->checkpointing = false;
+    this->removedKeys.clear();
+    this->expiryQueue.clear();
+    this->ttlKeys = 0;
+    if (this->filter != nullptr) {
+        this->filter->clear();
     }
+    recordChange(ChangeOp::Clear, std::string(), 0);
+}
+
+/*
+ *  reclaim - free nodes left over from clear()
+ *
+ *  params
+ *      maxNodes - most nodes to free in this call
+ *
+ *  returns - number of nodes freed
+ */
+size_t AVLTree::reclaim(size_t maxNodes) {
+    return freeSubtrees(this->reclaimQueue, maxNodes);
+}
+
+/*
+ *  reclaimPending - true while nodes from clear() are still waiting to be freed on this tree
+ */
+bool AVLTree::reclaimPending() const {
+    return !this->reclaimQueue.empty();
+}
 
-    if (curNode->right != nullptr) {
-        if (deleteHelper(curNode->right)) {
-            curNode->right = nullptr;
+/*
+ *  setBackgroundReclaim - when enabled detached nodes go to a shared background thread, anything already waiting
+ *      on this tree is handed over too
+ *
+ *  params
+ *      enabled - true to free nodes in the background
+ */
+void AVLTree::setBackgroundReclaim(bool enabled) {
+    this->backgroundReclaim = enabled;
+    if (enabled) {
+        for (AVLNode* pending : this->reclaimQueue) {
+            backgroundReclaimer().add(pending);
         }
+        this->reclaimQueue.clear();
     }
+}
 
-    delete curNode;
-    curNode = nullptr;
-
-    return true;
+/*
+ *  freeSubtrees - free nodes without recursion so huge trees can not overflow the stack and the work can stop
+ *      after any node
+ *
+ *  params
+ *      pending - tops of subtrees waiting to be freed
+ *      maxNodes - most nodes to free
+ *
+ *  returns - number of nodes freed
+ */
+size_t AVLTree::freeSubtrees(std::vector<AVLNode*> &pending, size_t maxNodes) {
+    size_t freed = 0;
+    while (freed < maxNodes and !pending.empty()) {
+        AVLNode* node = pending.back();
+        pending.pop_back();
+        if (node->left != nullptr) {
+            pending.push_back(node->left);
+        }
+        if (node->right != nullptr) {
+            pending.push_back(node->right);
+        }
+        freeNode(node);
+        freed++;
+    }
+    return freed;
 }
 
 /*
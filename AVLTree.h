@@ -5,30 +5,196 @@
 #ifndef AVLTREE_H
 #define AVLTREE_H
 #include <string>
+#include <string_view>
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <ostream>
+#include <istream>
 #include <optional>
+#include <functional>
+#include <utility>
+#include <span>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include "LatencyHistogram.h"
+#include "CountingBloomFilter.h"
 
 using namespace std;
 
+class TraceRecorder;
+
 class AVLTree {
 public:
     // using KeyType = std::string;
     // using ValueType = size_t;
     bool insert(const std::string& key, size_t value);
+    // inserts key or overwrites its value, true if key was inserted
+    bool insert_or_assign(std::string key, size_t value);
+    // inserts key with value if absent, returns the stored value and whether key was inserted
+    std::pair<size_t&, bool> try_emplace(std::string key, size_t value);
+    // replaces the value of an existing key with fn(value), false if key is absent
+    bool update(const std::string& key, const std::function<size_t(size_t)>& fn);
+    // inserts defaultValue if key is absent otherwise applies fn to its value, returns the stored value
+    size_t& upsert(std::string key, size_t defaultValue, const std::function<size_t(size_t)>& fn);
+    // like insert and upsert, the key expires ttl from now. Reads no longer see an expired key, remove() reclaims it
+    // but returns false and writing it again treats it as absent. Writes without a ttl leave the expiry of a live
+    // key alone. Expired keys still count in size(), bytes() and aggregates until sweepExpired removes them
+    bool insert(const std::string& key, size_t value, std::chrono::milliseconds ttl);
+    size_t& upsert(std::string key, size_t defaultValue, const std::function<size_t(size_t)>& fn, std::chrono::milliseconds ttl);
+    // gives a live key a new ttl, false if key is absent or expired
+    bool expire(const std::string& key, std::chrono::milliseconds ttl);
+    // removes up to maxKeys expired keys, soonest expiry first, returns how many were removed. Only keys that have
+    // expired are looked at so the cost follows what expires, not the size of the tree
+    size_t sweepExpired(size_t maxKeys = SIZE_MAX);
+    // keys with a ttl still in the tree, expired or not
+    size_t expiringKeys() const;
     bool contains(const std::string& key) const;
     std::optional<size_t> get(const std::string& key) const;
+    // looks up every key at once, out[i] gets the value of keys[i]. Sorted batches share their common descent
+    void getMany(std::span<const std::string> keys, std::span<std::optional<size_t>> out) const;
     size_t& operator[](const std::string& key);
     vector<std::string> findRange( const std::string& lowKey, const std::string& highKey) const;
     std::vector<std::string> keys() const;
     size_t size() const;
+    // height of the tree, under WAVL this is the root rank which is never less than the height
     size_t getHeight() const;
     bool remove(const std::string& key);
+    // replaces every key with entries in O(n), building a balanced tree directly. false (and nothing changed) unless
+    // the keys are in strictly increasing order
+    bool assignSorted(std::span<const std::pair<std::string_view, size_t>> entries);
     AVLTree(const AVLTree& other);
     AVLTree();
+    // strict AVL keeps every node within one level of balance, WAVL (weak AVL, rank balanced) lets ranks differ by
+    // 1 or 2 which keeps O(log n) lookups with O(1) amortized rotations per insert or remove
+    enum class BalancePolicy { AVL, WAVL };
+    explicit AVLTree(BalancePolicy policy);
     void operator=(const AVLTree& other);
     ~AVLTree();
 
+    // associative combine function and its identity, kept per node over the values of its subtree
+    struct Aggregate {
+        std::function<size_t(size_t, size_t)> combine;
+        size_t identity = 0;
+
+        static Aggregate sum();
+        static Aggregate min();
+        static Aggregate max();
+    };
+    // turns on (or replaces) the per node aggregate, recomputes it for the whole tree
+    void setAggregate(const Aggregate& aggregate);
+    // combined values of all keys lowKey <= key <= highKey in O(log n)
+    size_t aggregateRange(const std::string& lowKey, const std::string& highKey) const;
+
+    // which key gets evicted once the tree is over capacity
+    enum class EvictionPolicy { LeastRecentlyUsed, Clock, SmallestKey, LargestKey };
+    // limits the tree to maxEntries keys and maxBytes of node and key storage, 0 means no limit. With LRU or CLOCK
+    // every get, contains and getMany updates the recency list, so threads reading the tree at the same time need
+    // a lock just like writers do
+    void setCapacity(size_t maxEntries, size_t maxBytes, EvictionPolicy policy);
+    // approximate memory held by nodes and their keys
+    size_t bytes() const;
+
+    // an AVL tree may always switch to WAVL, switching back only works while the tree is empty
+    bool setBalancePolicy(BalancePolicy policy);
+    BalancePolicy getBalancePolicy() const;
+    // number of single rotations done since the tree was created
+    size_t rotations() const;
+    // true if keys are in order, parent links agree and every height (or WAVL rank), aggregate and count matches
+    // the nodes below it, used by the tests
+    bool checkInvariants() const;
+
+    // empties the tree in O(1), the old nodes are freed a batch at a time by later calls or in the background
+    void clear();
+    // frees up to maxNodes nodes left over from clear(), returns how many were freed
+    size_t reclaim(size_t maxNodes = SIZE_MAX);
+    bool reclaimPending() const;
+    // hands nodes from clear(), assignment and destruction to a background thread instead
+    void setBackgroundReclaim(bool enabled);
+
+    // holds up to maxEntries new keys from insert() in a small sorted buffer and merges them into the tree in key
+    // order once it is full or its oldest entry is maxAge old (0 for no age limit). Reads see buffered keys,
+    // maxEntries 0 merges the buffer and turns buffering off. The age is only checked by insert(), call
+    // flushWriteBuffer to merge a buffer that has gone idle. insert() still has to search the tree to report
+    // whether a key is new unless a filter is set and rules the key out, so the buffer pays off with a filter
+    void setWriteBuffer(size_t maxEntries, std::chrono::milliseconds maxAge);
+    void flushWriteBuffer();
+
+    // writes every key to os as a full checkpoint that later deltas build on, false if the write failed
+    bool writeSnapshot(std::ostream& os);
+    // writes only the keys changed or removed since the last checkpoint (a full snapshot if there is none yet).
+    // Keys handed out by operator[], try_emplace or upsert count as changed
+    bool writeCheckpoint(std::ostream& os);
+    // loads a snapshot in place of the current keys or applies the delta that follows the last applied
+    // checkpoint, false if is is not one of those or is cut short
+    bool applyCheckpoint(std::istream& is);
+    // merges a snapshot or delta and the deltas written after it into one checkpoint written to out
+    static bool compactCheckpoints(std::span<std::istream* const> inputs, std::ostream& out);
+
+    // calls that can be timed, copy covers the copy constructor and assignment from this tree
+    enum class TimedOp { Insert, Get, Remove, FindRange, Copy };
+    // times one call in sampleEvery of each TimedOp into a histogram, 0 stops timing and drops the histograms.
+    // Not safe to call while other threads use the tree
+    void setLatencySampling(size_t sampleEvery);
+    // latencies of op sampled since timing started or the last reset, empty while timing is off
+    LatencySnapshot latencySnapshot(TimedOp op, bool reset = false) const;
+
+    // moves every node into contiguous blocks, the top levels breadth first and each subtree below them depth first,
+    // so lookups and scans touch fewer cache lines. References returned by operator[] and the like are invalidated
+    void compact();
+    // plans a compaction that compactStep carries out a few nodes at a time between other calls
+    void startCompaction();
+    // moves up to maxNodes nodes, returns true once the compaction is finished
+    bool compactStep(size_t maxNodes);
+    bool compactionPending() const;
+
+    struct FilterStats {
+        size_t bytes = 0;
+        // keys the filter is currently sized for
+        size_t capacity = 0;
+        // lookups of absent keys answered by the filter alone
+        size_t rejected = 0;
+        // lookups the filter let through that still found nothing
+        size_t falsePositives = 0;
+        // rate to expect with the current keys, and the rate seen so far over every lookup of an absent key
+        double expectedFalsePositiveRate = 0;
+        double observedFalsePositiveRate = 0;
+    };
+    // keeps a counting Bloom filter of the keys so get, contains and unsorted getMany batches skip the descent for
+    // most absent keys. Sized for expectedKeys at falsePositiveRate and rebuilt twice as large whenever the tree
+    // outgrows it, expectedKeys 0 drops the filter
+    void setFilter(size_t expectedKeys, double falsePositiveRate = 0.01);
+    // zeroed stats while there is no filter, counts start over with each setFilter
+    FilterStats filterStats() const;
+
+    // one change in the changefeed. Clear empties the tree, its key and value are unused
+    enum class ChangeOp : uint8_t { Insert, Update, Remove, Clear };
+    struct ChangeEvent {
+        uint64_t sequence;
+        ChangeOp op;
+        std::string key;
+        size_t value;
+    };
+    // keeps the latest maxEvents changes for followers to read, coalesce keeps only the newest change of each key.
+    // 0 stops the feed. Evictions and swept expiries are sent as removals, ttls themselves are not sent. Buffered
+    // inserts are logged once they are merged into the tree
+    void setChangeFeed(size_t maxEvents, bool coalesce = false);
+    // sequence of the newest change
+    uint64_t changeSequence() const;
+    // appends up to maxEvents changes made after afterSequence to out, oldest first. Values written through the
+    // references returned by operator[], try_emplace and upsert are read when the change is read. false if the
+    // feed is off or changes after afterSequence were already dropped, the follower then has to be copied afresh
+    bool readChanges(uint64_t afterSequence, size_t maxEvents, std::vector<ChangeEvent>& out) const;
+    // follower side, applies changes read from a leader in order. Changes at or before appliedChangeSequence are
+    // skipped so a batch can safely be applied twice. false if the sequences are not increasing
+    bool applyChanges(std::span<const ChangeEvent> events);
+    // newest change applied, a copy of a tree starts at that trees changeSequence so it can resume from there
+    uint64_t appliedChangeSequence() const;
+
+    // records insert, get, remove, findRange and operator[] calls to recorder, nullptr stops recording.
+    // recorder must outlive the tree or be removed first
+    void setTraceRecorder(TraceRecorder* recorder);
 
 
 protected:
@@ -40,7 +206,23 @@ protected:
 
         std::string key;
         size_t value;
+        // height for AVL, rank for WAVL (never less than the height)
         size_t height;
+        // aggregate of this nodes subtree, only kept up to date when the tree has an aggregate set
+        size_t aggregate;
+
+        // recency list used by LRU and CLOCK eviction, most recent at the head
+        AVLNode* usePrev;
+        AVLNode* useNext;
+        // CLOCK reference bit
+        bool referenced;
+        // changed since the last checkpoint, and whether this node or any below it is
+        bool dirty;
+        bool subtreeDirty;
+        // lives in a NodeBlock from compact() instead of its own allocation
+        bool inArena;
+        // noExpiry unless the key was given a ttl
+        std::chrono::steady_clock::time_point expiresAt;
 
         AVLNode* left;
         AVLNode* right;
@@ -55,30 +237,271 @@ protected:
         int getBalance() const;
     };
 
+    struct BufferedInsert {
+        std::string key;
+        size_t value;
+        // node with the next smaller key when key was buffered, nullptr if there was none
+        AVLNode* predecessor;
+        // false when the filter ruled key out so the tree was not searched and predecessor is unknown
+        bool hinted;
+        // structureVersion when predecessor was found
+        size_t structureVersion;
+    };
+
+    // start of a nodeBlockBytes aligned block that compact() moves nodes into, the nodes follow the header
+    struct NodeBlock {
+        // nodes still alive in the block, plus one while a compaction is filling it
+        std::atomic<size_t> liveNodes;
+        // compaction that filled the block
+        size_t generation;
+    };
+
+    static constexpr std::chrono::steady_clock::time_point noExpiry = std::chrono::steady_clock::time_point::max();
+
+    // when key expires, entries are left behind when a key is removed or given a new ttl and skipped once popped
+    struct ExpiryEntry {
+        std::chrono::steady_clock::time_point expiresAt;
+        std::string key;
+    };
+
+    struct LoggedChange {
+        ChangeEvent event;
+        // a newer change of the same key replaced this one in a coalesced feed
+        bool superseded;
+        // the value may be written later through a returned reference, read it from the node instead
+        bool valueByReference;
+    };
+
+    struct CheckpointHeader {
+        // snapshots hold every key, deltas only the changes since baseSequence
+        bool snapshot;
+        uint64_t baseSequence;
+        uint64_t sequence;
+    };
+
 public:
 
     private:
     AVLNode* root;
     size_t treeSize;
+    Aggregate aggregateFunction;
+    size_t treeBytes;
+    size_t maxEntries;
+    size_t maxBytes;
+    EvictionPolicy evictionPolicy;
+    // recency list ends and the CLOCK hand, reads move nodes around so these change in const methods
+    mutable AVLNode* recencyHead;
+    mutable AVLNode* recencyTail;
+    mutable AVLNode* clockHand;
+    TraceRecorder* traceRecorder;
+    BalancePolicy balancePolicy;
+    size_t rotationCount;
+    // where the last removeNode left a hole, WAVL rebalances upward from here
+    AVLNode* removedParent;
+    AVLNode* removedChild;
+    // detached subtrees waiting to be freed
+    std::vector<AVLNode*> reclaimQueue;
+    bool backgroundReclaim;
+    // buffered inserts sorted by key, none of these keys are in the tree
+    std::vector<BufferedInsert> writeBuffer;
+    size_t writeBufferLimit;
+    std::chrono::milliseconds writeBufferMaxAge;
+    std::chrono::steady_clock::time_point writeBufferOldest;
+    // bumped whenever a node is linked or unlinked, buffered predecessor hints are only good while it is unchanged
+    size_t structureVersion;
+    // true while the last written or applied checkpoint still describes this tree apart from the dirty nodes
+    // and removedKeys, until then a checkpoint has to be a full snapshot
+    bool checkpointing;
+    uint64_t checkpointSequence;
+    // keys removed since the last checkpoint
+    std::vector<std::string> removedKeys;
+    // one histogram per TimedOp while timing is on, otherwise nullptr
+    static constexpr size_t timedOpCount = 5;
+    LatencyHistogram* latencyHistograms;
+    // histogram for op or nullptr while timing is off
+    LatencyHistogram* latencyHistogram(TimedOp op) const;
+    // nodes a running compaction still has to move, in their new order
+    std::vector<AVLNode*> compactionPlan;
+    size_t compactionNext;
+    bool compactionActive;
+    // a node was freed since the plan was made so it may hold dangling pointers
+    bool compactionStale;
+    size_t compactionGeneration;
+    // block being filled and how many of its slots are used
+    NodeBlock* compactionBlock;
+    size_t compactionBlockUsed;
+    // min heap of expiry times, soonest on top
+    std::vector<ExpiryEntry> expiryQueue;
+    // nodes whose expiresAt is not noExpiry
+    size_t ttlKeys;
+    // changes in sequence order, 0 changeLogLimit while the feed is off
+    std::deque<LoggedChange> changeLog;
+    size_t changeLogLimit;
+    bool changeCoalesce;
+    uint64_t changeSequenceNumber;
+    // newest change dropped from the front of the log, followers behind it cannot resume
+    uint64_t changesDroppedThrough;
+    // coalesced feeds only, sequence of the newest change of each key in the log
+    std::unordered_map<std::string, uint64_t> latestChange;
+    size_t supersededChanges;
+    uint64_t appliedSequence;
+    // keys in the tree (buffered keys are checked before it) or nullptr while there is no filter
+    CountingBloomFilter* filter;
+    double filterFalsePositiveRate;
+    // counted by const lookups, which may run on several threads at once
+    mutable std::atomic<size_t> filterRejected;
+    mutable std::atomic<size_t> filterFalsePositives;
     AVLNode* getNodePlace(const std::string& key, AVLNode* curNode) const;
-    bool insertNode(const std::string& key, size_t value, AVLNode* curNode);
-    bool rangeHelper(const std::string &lowKey, const std::string &highKey, vector<std::string>& returnVector, AVLNode* curNode) const;
-    bool keysHelper(AVLNode* curNode, vector<std::string>& returnVector) const;
+    // number of lookups getMany keeps in flight at once
+    static constexpr size_t lookupGroupSize = 16;
+    void getManyInterleaved(std::span<const std::string> keys, std::span<std::optional<size_t>> out) const;
+    void getManySortedHelper(AVLNode* curNode, std::span<const std::string> keys, std::span<std::optional<size_t>> out) const;
+    AVLNode* insertNode(std::string& key, size_t value, AVLNode*& curNode, AVLNode* parent, bool& inserted);
+    void refreshAggregates(AVLNode* node);
+
+    /* Helper methods for capacity and eviction */
+    static size_t nodeBytes(const AVLNode* node);
+    bool usesRecencyList() const;
+    // bookkeeping for a node entering or leaving the tree
+    void linkNode(AVLNode* node);
+    void unlinkNode(AVLNode* node);
+    // records a read or write of node for the eviction policy
+    void touchNode(AVLNode* node) const;
+    void pushRecencyFront(AVLNode* node) const;
+    void pushRecencyBack(AVLNode* node) const;
+    void pushBehindHand(AVLNode* node) const;
+    void removeFromRecency(AVLNode* node) const;
+    void rebuildRecencyList();
+    void recencyHelper(AVLNode* curNode);
+    AVLNode* chooseVictim(AVLNode* keep);
+    // evicts until the tree is back within capacity, never evicting keep
+    void enforceCapacity(AVLNode* keep);
+    void rangeHelper(const std::string &lowKey, const std::string &highKey, vector<std::string>& returnVector, AVLNode* curNode, size_t& bufferIndex) const;
+    void keysHelper(AVLNode* curNode, vector<std::string>& returnVector, size_t& bufferIndex) const;
     bool copyHelper(AVLNode* curNodeOld, AVLNode* curNode) const;
-    bool deleteHelper(AVLNode* curNode) const;
+    // builds a balanced subtree of entries below parent, returns its top
+    AVLNode* buildSortedHelper(std::span<const std::pair<std::string_view, size_t>> entries, AVLNode* parent);
+    void deleteHelper(AVLNode* curNode);
+
+    /* Helper methods for freeing nodes */
+    // nodes freed by each insert or remove while a clear() is still being reclaimed
+    static constexpr size_t reclaimBatchSize = 64;
+    class BackgroundReclaimer;
+    static BackgroundReclaimer& backgroundReclaimer();
+    // frees up to maxNodes nodes from the subtrees in pending, children of freed nodes are pushed back on
+    static size_t freeSubtrees(std::vector<AVLNode*>& pending, size_t maxNodes);
+
+    /* Helper methods for compaction */
+    static constexpr size_t nodeBlockBytes = 64 * 1024;
+    // levels laid out breadth first, chosen so they fit in one block
+    size_t compactionTopLevels() const;
+    static size_t nodeBlockOffset();
+    static size_t nodesPerBlock();
+    // orders every node not yet moved by this compaction
+    void planCompaction();
+    // moves node into the next free slot and repoints everything that pointed at it
+    AVLNode* relocateNode(AVLNode* node);
+    void finishCompaction();
+    bool placedByCompaction(const AVLNode* node) const;
+    static NodeBlock* blockOf(const AVLNode* node);
+    static void releaseBlock(NodeBlock* block);
+    // deletes a node whether it was allocated on its own or lives in a block
+    static void freeNode(AVLNode* node);
+
+    /* Helper methods for expiry */
+    // inserts key like try_emplace, an expired node holding key is reused as if it were new
+    AVLNode* emplaceNode(std::string& key, size_t value, bool& inserted);
+    AVLNode* upsertNode(std::string& key, size_t defaultValue, const std::function<size_t(size_t)>& fn);
+    bool isExpired(const AVLNode* node) const;
+    // gives an expired node a new value and no expiry
+    void reviveNode(AVLNode* node, size_t value);
+    void setExpiry(AVLNode* node, std::chrono::steady_clock::time_point expiresAt);
+    static bool expiresLater(const ExpiryEntry& a, const ExpiryEntry& b);
+    void rebuildExpiryQueue();
+    void expiryHelper(AVLNode* curNode);
+
+    /* Helper methods for the changefeed */
+    void recordChange(ChangeOp op, const std::string& key, size_t value);
+    // records that the value of node may be changed through a reference handed out for it
+    void recordChangeByReference(const AVLNode* node);
+    LoggedChange* findChange(uint64_t sequence);
+    // drops changes past changeLogLimit and superseded ones
+    void trimChangeLog();
+    void changeHelper(AVLNode* curNode);
+
+    /* Helper methods for the filter */
+    // true if the filter rules key out, counted as a rejection
+    bool filterRejects(const std::string& key) const;
+    // counts a lookup the filter let through that missed
+    void filterMissed() const;
+    void rebuildFilter(size_t expectedKeys);
+    void filterHelper(AVLNode* curNode);
+
+    /* Helper methods for the write buffer */
+    bool bufferInsert(const std::string& key, size_t value);
+    // finds the node for key or else the node with the next smaller key, searching the subtree under start
+    AVLNode* findOrPredecessor(const std::string& key, AVLNode* start, bool& found) const;
+    // subtree above node (which has a smaller key) that holds the place of key
+    AVLNode* searchStart(AVLNode* node, const std::string& key) const;
+    // links a new node for key directly after predecessor (or first if nullptr) without searching from the root
+    AVLNode* insertAfter(AVLNode* predecessor, std::string& key, size_t value);
+    // updates and balances from node up to the root, stopping early once nothing above can change
+    void rebalanceUpward(AVLNode* node);
+    // index of key in the write buffer or of where it would go
+    size_t bufferPosition(const std::string& key) const;
+    // value of key if it is in the write buffer otherwise nullptr
+    const size_t* bufferedValue(const std::string& key) const;
+    // merges the buffer before key is changed in place if key is still buffered
+    void flushIfBuffered(const std::string& key);
+    /* Helper methods for checkpoints */
+    // marks node as changed and every node above it as having a changed node below
+    void markDirty(AVLNode* node);
+    // writes every node under curNode in key order and clears their dirty flags
+    void snapshotHelper(AVLNode* curNode, std::ostream& os, bool withValues);
+    // adds the dirty nodes under curNode in key order and clears their dirty flags
+    void collectDirty(AVLNode* curNode, std::vector<AVLNode*>& dirtyNodes);
+    static void writeCheckpointHeader(std::ostream& os, const CheckpointHeader& header);
+    static bool readCheckpointHeader(std::istream& is, CheckpointHeader& header);
+    // reads the removed keys then the changed keys of a checkpoint
+    static bool readCheckpointBody(std::istream& is, const std::function<void(std::string&)>& onRemove,
+                                   const std::function<void(std::string&, size_t)>& onPut);
+    size_t treeAggregateRange(const std::string& lowKey, const std::string& highKey) const;
+    void aggregateHelper(AVLNode* curNode);
+    size_t subtreeAggregate(AVLNode* node) const;
 
     friend bool printRightSide(AVLNode* node, int depth, ostream& os);
     friend bool printLeftSide(AVLNode* node, int depth, ostream& os);
     friend std::ostream& operator<<(ostream& os, const AVLTree & avlTree);
     /* Helper methods for remove */
     // this overloaded remove will do the recursion to remove the node
-    bool remove(AVLNode*& current, std::string key);
+    bool remove(AVLNode*& current, const std::string& key);
     // removeNode contains the logic for actually removing a node based on the numebr of children
     bool removeNode(AVLNode*& current);
+    // unlinks the smallest node under node and rebalances on the way back up
+    AVLNode* detachSmallest(AVLNode*& node);
     // You will implement this, but it is needed for removeNode()
     void balanceNode(AVLNode*& node);
 
+    // recomputes height and aggregate of node from its children
+    void updateNode(AVLNode* node);
+    // points parents link (or root) at newChild instead of oldChild
+    void replaceChild(AVLNode* parent, AVLNode* oldChild, AVLNode* newChild);
     void RightRotate(AVLNode *pivotNode);
+    void LeftRotate(AVLNode *pivotNode);
+    // rebalancing and bookkeeping once insertNode has created node
+    void finishInsert(AVLNode* node);
+    // removes key and rebalances
+    bool removeKey(const std::string& key);
+
+    /* Helper methods for WAVL balancing */
+    static long rankOf(const AVLNode* node);
+    // promotes and rotates upward from a newly inserted leaf
+    void wavlInsertFixup(AVLNode* node);
+    // demotes and rotates upward from the hole left by a removal, child may be nullptr
+    void wavlDeleteFixup(AVLNode* parent, AVLNode* child);
+    // checks the subtree under curNode, whose keys must lie between lowKey and highKey (nullptr for no bound)
+    bool invariantHelper(const AVLNode* curNode, const AVLNode* parent, const std::string* lowKey,
+                         const std::string* highKey, size_t& nodeCount, size_t& byteCount) const;
 };
 
 #endif //AVLTREE_H
@@ -0,0 +1,132 @@
+/*
+Benchmarks write workloads under each balancing policy and reports throughput
+and rotations per operation.
+
+usage: AVLTreeBench [keys]
+ */
+#include "AVLTree.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct BenchResult {
+    double seconds;
+    size_t operations;
+    size_t rotations;
+};
+
+/*
+ *  printResult - one line per workload with ops/s and rotations/op
+ */
+void printResult(const string& policy, const string& workload, const BenchResult& result) {
+    cout << policy << "\t" << workload << "\t"
+         << static_cast<size_t>(result.operations / result.seconds) << " ops/s\t"
+         << static_cast<double>(result.rotations) / result.operations << " rotations/op" << endl;
+}
+
+/*
+ *  bench - time fn, counting the rotations it caused on tree
+ */
+template <typename Fn>
+BenchResult bench(AVLTree& tree, size_t operations, Fn fn) {
+    size_t rotationsBefore = tree.rotations();
+    auto start = chrono::steady_clock::now();
+    fn();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return {seconds, operations, tree.rotations() - rotationsBefore};
+}
+
+int main(int argc, char* argv[]) {
+    size_t keyCount = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200000;
+
+    //same keys and order for both policies
+    mt19937_64 rng(42);
+    vector<string> keys;
+    for (size_t i = 0; i < 3 * keyCount; i++) {
+        keys.push_back("key" + to_string(rng()));
+    }
+    vector<size_t> churnOrder;
+    for (size_t i = 0; i < 2 * keyCount; i++) {
+        churnOrder.push_back(rng() % keyCount);
+    }
+
+    for (AVLTree::BalancePolicy policy : {AVLTree::BalancePolicy::AVL, AVLTree::BalancePolicy::WAVL}) {
+        string name = (policy == AVLTree::BalancePolicy::AVL) ? "avl" : "wavl";
+        AVLTree tree(policy);
+
+        //random inserts into a growing tree
+        printResult(name, "insert", bench(tree, keyCount, [&] {
+            for (size_t i = 0; i < keyCount; i++) {
+                tree.insert(keys[i], i);
+            }
+        }));
+
+        //delete heavy churn, each step removes a live key and inserts a new one
+        vector<size_t> live(keyCount);
+        for (size_t i = 0; i < keyCount; i++) {
+            live[i] = i;
+        }
+        size_t nextKey = keyCount;
+        printResult(name, "churn", bench(tree, 2 * churnOrder.size(), [&] {
+            for (size_t slot : churnOrder) {
+                tree.remove(keys[live[slot]]);
+                live[slot] = nextKey++;
+                tree.insert(keys[live[slot]], slot);
+            }
+        }));
+
+        //lookups still cost O(log n)
+        auto start = chrono::steady_clock::now();
+        size_t found = 0;
+        for (size_t i = 0; i < keyCount; i++) {
+            found += tree.contains(keys[live[i]]);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << name << "\tlookup\t" << static_cast<size_t>(keyCount / seconds) << " ops/s\theight "
+             << tree.getHeight() << "\tfound " << found << endl;
+
+        //drain everything
+        printResult(name, "drain", bench(tree, keyCount, [&] {
+            for (size_t i = 0; i < keyCount; i++) {
+                tree.remove(keys[live[i]]);
+            }
+        }));
+        cout << endl;
+    }
+
+    //bursts of random and of ascending inserts into a tree that already holds keyCount keys, with and without a
+    //write buffer and a filter that lets buffered inserts skip the descent
+    vector<string> ascending;
+    for (size_t i = 0; i < keyCount; i++) {
+        ascending.push_back("key5" + to_string(keyCount + i));
+    }
+    for (bool filtered : {false, true}) {
+        for (size_t bufferSize : {size_t(0), size_t(64), size_t(512)}) {
+            for (bool random : {true, false}) {
+                AVLTree tree;
+                if (filtered) {
+                    tree.setFilter(3 * keyCount);
+                }
+                for (size_t i = 0; i < keyCount; i++) {
+                    tree.insert(keys[i], i);
+                }
+                tree.setWriteBuffer(bufferSize, chrono::milliseconds(0));
+                const vector<string>& burst = random ? keys : ascending;
+                size_t first = random ? keyCount : 0;
+                BenchResult result = bench(tree, keyCount, [&] {
+                    for (size_t i = first; i < first + keyCount; i++) {
+                        tree.insert(burst[i], i);
+                    }
+                    tree.flushWriteBuffer();
+                });
+                printResult(string(filtered ? "filter " : "") + "buffer " + to_string(bufferSize),
+                            random ? "burst" : "ascending burst", result);
+            }
+        }
+    }
+    return 0;
+}
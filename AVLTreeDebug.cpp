@@ -4,6 +4,7 @@ This is NOT the test code for grading,
 instead for you to get an idea of how to test the tree
  */
 #include "AVLTree.h"
+#include "StaticAVLTree.h"
 #include <iostream>
 #include <string>
 #include <ranges>
@@ -120,5 +121,15 @@ int main() {
 //    cout << endl << endl;
 //    cout << tree << endl;
 
+    // fixed key sets can be built at compile time instead
+    constexpr StaticAVLTree commands({{"add", 1}, {"help", 2}, {"list", 3}, {"remove", 4}});
+    static_assert(commands.contains("list"));
+    cout << "commands size: " << commands.size() << endl; // 4
+    cout << "remove: " << commands.get("remove").value() << endl; // 4
+    for (auto val: commands.findRange("b", "m")) {
+        cout << val << " "; // 2 3
+    }
+    cout << endl;
+
     return 0;
 }
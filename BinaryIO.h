@@ -0,0 +1,81 @@
+/**
+ * BinaryIO.h
+ *
+ * Small helpers for the compact binary files written by the tree (traces, checkpoints).
+ * Integers are stored as LEB128 varints and strings as a varint length followed by the bytes.
+ */
+
+#ifndef BINARYIO_H
+#define BINARYIO_H
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+/*
+ *  writeVarint - write value 7 bits at a time, high bit set on every byte but the last
+ */
+inline void writeVarint(std::ostream& os, uint64_t value) {
+    while (value >= 0x80) {
+        os.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    os.put(static_cast<char>(value));
+}
+
+/*
+ *  readVarint - read a value written by writeVarint
+ *
+ *  returns - false if the stream ended or the varint is too long
+ */
+inline bool readVarint(std::istream& is, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = is.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ *  writeString - write the length of str followed by its bytes
+ */
+inline void writeString(std::ostream& os, const std::string& str) {
+    writeVarint(os, str.size());
+    os.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+/*
+ *  readString - read a string written by writeString into str. The length is not trusted, the bytes are read
+ *      a chunk at a time so a corrupt length fails at the end of the stream instead of allocating it up front
+ *
+ *  returns - false if the stream ended early
+ */
+inline bool readString(std::istream& is, std::string& str) {
+    constexpr uint64_t chunkSize = 64 * 1024;
+    uint64_t length;
+    if (!readVarint(is, length)) {
+        return false;
+    }
+    str.clear();
+    while (str.size() < length) {
+        size_t offset = str.size();
+        size_t count = static_cast<size_t>(std::min(length - offset, chunkSize));
+        str.resize(offset + count);
+        is.read(str.data() + offset, static_cast<std::streamsize>(count));
+        if (static_cast<size_t>(is.gcount()) != count) {
+            str.resize(offset + static_cast<size_t>(is.gcount()));
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif //BINARYIO_H
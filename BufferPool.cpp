@@ -0,0 +1,232 @@
+#include "BufferPool.h"
+
+#include <cstring>
+
+/*
+ *  BufferPool constructor - counts the pages already in file
+ *
+ *      params
+ *          file - open page file
+ *          pageSize - bytes per page
+ *          maxPages - most pages cached at once
+ */
+BufferPool::BufferPool(std::fstream &file, size_t pageSize, size_t maxPages) : file(file) {
+    this->framePageSize = pageSize;
+    this->maxPages = maxPages;
+    this->reads = 0;
+    this->writes = 0;
+    this->lruHead = SIZE_MAX;
+    this->lruTail = SIZE_MAX;
+    this->file.seekg(0, std::ios::end);
+    std::streamoff fileBytes = this->file.tellg();
+    //a partial last page still counts so a short file is never taken for an empty one
+    this->filePages = fileBytes > 0 ? (static_cast<uint64_t>(fileBytes) + pageSize - 1) / pageSize : 0;
+    this->file.clear();
+}
+
+/*
+ *  fetchPage - pin a page, loading it into a frame first if it is not cached
+ *
+ *  params
+ *      pageId - page number
+ *
+ *  returns - the page bytes, valid until the page is unpinned. nullptr if it could not be loaded
+ */
+char* BufferPool::fetchPage(uint64_t pageId) {
+    auto cached = this->pageTable.find(pageId);
+    if (cached != this->pageTable.end()) {
+        pin(cached->second);
+        return this->frames[cached->second].data.data();
+    }
+    if (pageId >= this->filePages) {
+        return nullptr;
+    }
+
+    size_t frameIndex = takeFrame();
+    if (frameIndex == SIZE_MAX) {
+        return nullptr;
+    }
+    Frame& frame = this->frames[frameIndex];
+    this->file.seekg(static_cast<std::streamoff>(pageId * this->framePageSize));
+    this->file.read(frame.data.data(), static_cast<std::streamsize>(this->framePageSize));
+    //past the end of a short file the page reads as zeroes
+    if (this->file.gcount() < static_cast<std::streamsize>(this->framePageSize)) {
+        std::memset(frame.data.data() + this->file.gcount(), 0, this->framePageSize - this->file.gcount());
+    }
+    this->file.clear();
+    this->reads++;
+
+    frame.pageId = pageId;
+    frame.dirty = false;
+    this->pageTable[pageId] = frameIndex;
+    pin(frameIndex);
+    return frame.data.data();
+}
+
+/*
+ *  newPage - add a page to the end of the file. It is only written once it is evicted or flushed
+ *
+ *  params
+ *      pageId - set to the new page number
+ *
+ *  returns - the zeroed page, pinned. nullptr if every frame is pinned
+ */
+char* BufferPool::newPage(uint64_t &pageId) {
+    size_t frameIndex = takeFrame();
+    if (frameIndex == SIZE_MAX) {
+        return nullptr;
+    }
+    Frame& frame = this->frames[frameIndex];
+    std::memset(frame.data.data(), 0, this->framePageSize);
+    pageId = this->filePages++;
+    frame.pageId = pageId;
+    frame.dirty = true;
+    this->pageTable[pageId] = frameIndex;
+    pin(frameIndex);
+    return frame.data.data();
+}
+
+/*
+ *  unpinPage - release a pin from fetchPage or newPage. The last unpin makes the page the most recently used
+ *
+ *  params
+ *      pageId - page being released
+ *      dirty - true if the page was changed while pinned
+ */
+void BufferPool::unpinPage(uint64_t pageId, bool dirty) {
+    auto cached = this->pageTable.find(pageId);
+    if (cached == this->pageTable.end()) {
+        return;
+    }
+    Frame& frame = this->frames[cached->second];
+    frame.dirty = frame.dirty or dirty;
+    if (frame.pinCount > 0 and --frame.pinCount == 0) {
+        frame.listed = true;
+        frame.lruPrev = SIZE_MAX;
+        frame.lruNext = this->lruHead;
+        if (this->lruHead != SIZE_MAX) {
+            this->frames[this->lruHead].lruPrev = cached->second;
+        }
+        else {
+            this->lruTail = cached->second;
+        }
+        this->lruHead = cached->second;
+    }
+}
+
+/*
+ *  flush - write back every changed page, pinned or not
+ *
+ *  returns - false if a write failed
+ */
+bool BufferPool::flush() {
+    bool written = true;
+    for (Frame& frame : this->frames) {
+        if (frame.dirty and !writeFrame(frame)) {
+            written = false;
+        }
+    }
+    this->file.flush();
+    return written and this->file.good();
+}
+
+/*
+ *  pageSize - bytes per page
+ */
+size_t BufferPool::pageSize() const {
+    return this->framePageSize;
+}
+
+/*
+ *  pageCount - number of pages, including new ones still only in memory
+ */
+uint64_t BufferPool::pageCount() const {
+    return this->filePages;
+}
+
+/*
+ *  pageReads - pages read from the file so far
+ */
+size_t BufferPool::pageReads() const {
+    return this->reads;
+}
+
+/*
+ *  pageWrites - pages written to the file so far
+ */
+size_t BufferPool::pageWrites() const {
+    return this->writes;
+}
+
+/*
+ *  takeFrame - a frame to load a page into. Grows until maxPages frames exist, after that the least recently used
+ *      unpinned page is written back if needed and dropped
+ *
+ *  returns - frame index, SIZE_MAX if every frame is pinned or the write back failed
+ */
+size_t BufferPool::takeFrame() {
+    if (this->frames.size() < this->maxPages) {
+        this->frames.push_back({0, std::vector<char>(this->framePageSize), 0, false, false, SIZE_MAX, SIZE_MAX});
+        return this->frames.size() - 1;
+    }
+    if (this->lruTail == SIZE_MAX) {
+        return SIZE_MAX;
+    }
+
+    size_t frameIndex = this->lruTail;
+    Frame& frame = this->frames[frameIndex];
+    if (frame.dirty and !writeFrame(frame)) {
+        return SIZE_MAX;
+    }
+    removeFromLru(frameIndex);
+    this->pageTable.erase(frame.pageId);
+    return frameIndex;
+}
+
+/*
+ *  writeFrame - write a frames page to its place in the file
+ *
+ *  returns - false if the write failed
+ */
+bool BufferPool::writeFrame(Frame &frame) {
+    this->file.seekp(static_cast<std::streamoff>(frame.pageId * this->framePageSize));
+    this->file.write(frame.data.data(), static_cast<std::streamsize>(this->framePageSize));
+    if (!this->file.good()) {
+        this->file.clear();
+        return false;
+    }
+    frame.dirty = false;
+    this->writes++;
+    return true;
+}
+
+/*
+ *  pin - add a pin to a frame, the first pin takes it off the lru list so it can not be evicted
+ */
+void BufferPool::pin(size_t frameIndex) {
+    Frame& frame = this->frames[frameIndex];
+    frame.pinCount++;
+    if (frame.listed) {
+        removeFromLru(frameIndex);
+    }
+}
+
+/*
+ *  removeFromLru - unlink a frame from the lru list
+ */
+void BufferPool::removeFromLru(size_t frameIndex) {
+    Frame& frame = this->frames[frameIndex];
+    if (frame.lruPrev != SIZE_MAX) {
+        this->frames[frame.lruPrev].lruNext = frame.lruNext;
+    }
+    else {
+        this->lruHead = frame.lruNext;
+    }
+    if (frame.lruNext != SIZE_MAX) {
+        this->frames[frame.lruNext].lruPrev = frame.lruPrev;
+    }
+    else {
+        this->lruTail = frame.lruPrev;
+    }
+    frame.listed = false;
+}
@@ -0,0 +1,68 @@
+/**
+ * BufferPool.h
+ *
+ * Caches fixed-size pages of a file in a bounded number of frames. A page is pinned while it is in use and pinned
+ * pages are never evicted. Once every frame is taken, the least recently unpinned page is written back (if it was
+ * changed) to make room.
+ */
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+#include <cstdint>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+class BufferPool {
+public:
+    // file must be open for reading and writing, at most maxPages pages are kept in memory
+    BufferPool(std::fstream& file, size_t pageSize, size_t maxPages);
+
+    // pins pageId, reading it from the file if it is not cached. nullptr if the read failed or every frame is pinned
+    char* fetchPage(uint64_t pageId);
+    // pins a new zeroed page after the last one, sets pageId to its number
+    char* newPage(uint64_t& pageId);
+    // drops one pin on pageId, dirty means the page was changed and has to be written before it is evicted
+    void unpinPage(uint64_t pageId, bool dirty);
+    // writes every changed page, false if a write failed
+    bool flush();
+
+    size_t pageSize() const;
+    // pages in the file, counting new pages that are not written yet
+    uint64_t pageCount() const;
+    size_t pageReads() const;
+    size_t pageWrites() const;
+
+private:
+    struct Frame {
+        uint64_t pageId;
+        std::vector<char> data;
+        size_t pinCount;
+        bool dirty;
+        // neighbours in the lru list while unpinned
+        bool listed;
+        size_t lruPrev;
+        size_t lruNext;
+    };
+
+    std::fstream& file;
+    size_t framePageSize;
+    size_t maxPages;
+    uint64_t filePages;
+    std::vector<Frame> frames;
+    // page number to frame index of every cached page
+    std::unordered_map<uint64_t, size_t> pageTable;
+    // unpinned frames linked through lruPrev and lruNext, most recently used at the head. SIZE_MAX ends the list
+    size_t lruHead;
+    size_t lruTail;
+    size_t reads;
+    size_t writes;
+
+    // frame to load a page into, a free one or the least recently used unpinned one. SIZE_MAX if none is free
+    size_t takeFrame();
+    bool writeFrame(Frame& frame);
+    void pin(size_t frameIndex);
+    void removeFromLru(size_t frameIndex);
+};
+
+#endif //BUFFERPOOL_H
@@ -0,0 +1,160 @@
+#include "CountingBloomFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+/*
+ *  CountingBloomFilter constructor - empty filter. The standard Bloom sizing gives the counters per key and the
+ *      number of probes for the requested false positive rate. Keys spread unevenly over the blocks, so the filter
+ *      gets a quarter more counters to come close to the rate an unblocked filter would reach
+ *
+ *      params
+ *          expectedKeys - keys the filter should hold before its false positive rate climbs past the target
+ *          falsePositiveRate - target fraction of absent keys reported as maybe present
+ */
+CountingBloomFilter::CountingBloomFilter(size_t expectedKeys, double falsePositiveRate) {
+    this->expectedKeys = std::max<size_t>(expectedKeys, 1);
+    this->keyCount = 0;
+    falsePositiveRate = std::clamp(falsePositiveRate, 1e-6, 0.5);
+
+    double ln2 = std::log(2.0);
+    double countersPerKey = -std::log(falsePositiveRate) / (ln2 * ln2);
+    this->probes = std::clamp<size_t>(static_cast<size_t>(std::lround(countersPerKey * ln2)), 1, 16);
+    size_t counters = static_cast<size_t>(std::ceil(1.25 * countersPerKey * static_cast<double>(this->expectedKeys)));
+    this->blocks.assign(std::max<size_t>((counters + countersPerBlock - 1) / countersPerBlock, 1), Block{});
+}
+
+/*
+ *  add - count key in each of its counters, counters already at 15 are left there
+ */
+void CountingBloomFilter::add(const std::string &key) {
+    uint64_t keyHash = hash(key);
+    Block& block = blockFor(keyHash);
+    uint64_t probeState = keyHash;
+    for (size_t probe = 0; probe < this->probes; probe++) {
+        size_t index = nextCounter(probeState);
+        if (counter(block, index) < 15) {
+            block.words[index / 16] += uint64_t{1} << (index % 16 * 4);
+        }
+    }
+    this->keyCount++;
+}
+
+/*
+ *  remove - take key back out. A counter at 15 may have lost count so it is never lowered
+ */
+void CountingBloomFilter::remove(const std::string &key) {
+    uint64_t keyHash = hash(key);
+    Block& block = blockFor(keyHash);
+    uint64_t probeState = keyHash;
+    for (size_t probe = 0; probe < this->probes; probe++) {
+        size_t index = nextCounter(probeState);
+        size_t count = counter(block, index);
+        if (count != 0 and count < 15) {
+            block.words[index / 16] -= uint64_t{1} << (index % 16 * 4);
+        }
+    }
+    if (this->keyCount != 0) {
+        this->keyCount--;
+    }
+}
+
+/*
+ *  mayContain - true if every counter of key is set
+ *
+ *  params
+ *      key  - key being searched for
+ *
+ *  returns - false only for keys that are not in the filter
+ */
+bool CountingBloomFilter::mayContain(const std::string &key) const {
+    uint64_t keyHash = hash(key);
+    const Block& block = blockFor(keyHash);
+    uint64_t probeState = keyHash;
+    for (size_t probe = 0; probe < this->probes; probe++) {
+        if (counter(block, nextCounter(probeState)) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ *  clear - remove every key
+ */
+void CountingBloomFilter::clear() {
+    std::fill(this->blocks.begin(), this->blocks.end(), Block{});
+    this->keyCount = 0;
+}
+
+size_t CountingBloomFilter::capacity() const {
+    return this->expectedKeys;
+}
+
+size_t CountingBloomFilter::keys() const {
+    return this->keyCount;
+}
+
+size_t CountingBloomFilter::bytes() const {
+    return this->blocks.size() * sizeof(Block);
+}
+
+/*
+ *  expectedFalsePositiveRate - a probe into a block holding j keys finds all k of its counters set with probability
+ *      (1 - (1 - 1/128)^(kj))^k. The keys per block are close to Poisson distributed, so this is averaged over the
+ *      Poisson probabilities of each j
+ */
+double CountingBloomFilter::expectedFalsePositiveRate() const {
+    double k = static_cast<double>(this->probes);
+    double keysPerBlock = static_cast<double>(this->keyCount) / static_cast<double>(this->blocks.size());
+    double emptyCounter = 1.0 - 1.0 / static_cast<double>(countersPerBlock);
+    double chance = std::exp(-keysPerBlock);
+    double rate = 0;
+    size_t lastLoad = static_cast<size_t>(keysPerBlock + 10 * std::sqrt(keysPerBlock) + 10);
+    for (size_t load = 0; load <= lastLoad; load++) {
+        rate += chance * std::pow(1.0 - std::pow(emptyCounter, k * static_cast<double>(load)), k);
+        chance *= keysPerBlock / static_cast<double>(load + 1);
+    }
+    return rate;
+}
+
+/*
+ *  hash - std::hash of the key run through a 64 bit finalizer so the high bits are as mixed as the low ones
+ */
+uint64_t CountingBloomFilter::hash(const std::string &key) {
+    uint64_t keyHash = std::hash<std::string>{}(key);
+    keyHash ^= keyHash >> 33;
+    keyHash *= 0xFF51AFD7ED558CCDull;
+    keyHash ^= keyHash >> 33;
+    keyHash *= 0xC4CEB9FE1A85EC53ull;
+    keyHash ^= keyHash >> 33;
+    return keyHash;
+}
+
+/*
+ *  blockFor - the high 32 bits pick the block, scaled into range with a multiply instead of a division
+ */
+CountingBloomFilter::Block& CountingBloomFilter::blockFor(uint64_t hash) {
+    return this->blocks[((hash >> 32) * this->blocks.size()) >> 32];
+}
+
+const CountingBloomFilter::Block& CountingBloomFilter::blockFor(uint64_t hash) const {
+    return this->blocks[((hash >> 32) * this->blocks.size()) >> 32];
+}
+
+/*
+ *  nextCounter - steps a linear congruential generator seeded with the key hash, its top 7 bits pick the counter.
+ *      Two probes of one key can land on the same counter, add and remove then both count it twice
+ */
+size_t CountingBloomFilter::nextCounter(uint64_t &state) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return state >> 57;
+}
+
+/*
+ *  counter - value of the 4 bit counter at index
+ */
+size_t CountingBloomFilter::counter(const Block &block, size_t index) {
+    return (block.words[index / 16] >> (index % 16 * 4)) & 15;
+}
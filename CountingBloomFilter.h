@@ -0,0 +1,56 @@
+/**
+ * CountingBloomFilter.h
+ *
+ * Approximate set of keys that answers "definitely absent" or "maybe present". It is a blocked Bloom filter: a key
+ * hashes to one 64 byte block and all of its probes land in that block, so a check reads a single cache line. Each
+ * slot is a 4 bit counter instead of a bit so keys can be removed again. A counter that reaches 15 stays there,
+ * which can only add false positives, never false negatives.
+ */
+
+#ifndef COUNTINGBLOOMFILTER_H
+#define COUNTINGBLOOMFILTER_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CountingBloomFilter {
+public:
+    // sized for expectedKeys keys at about falsePositiveRate false positives
+    CountingBloomFilter(size_t expectedKeys, double falsePositiveRate);
+
+    void add(const std::string& key);
+    // key must have been added, removing a key that was never added can cause false negatives
+    void remove(const std::string& key);
+    // false means key was definitely never added (or was removed again)
+    bool mayContain(const std::string& key) const;
+    void clear();
+
+    // keys the filter was sized for and keys currently added
+    size_t capacity() const;
+    size_t keys() const;
+    size_t bytes() const;
+    // false positive rate to expect with the keys added so far
+    double expectedFalsePositiveRate() const;
+
+private:
+    static constexpr size_t countersPerBlock = 128;
+
+    // one cache line of 4 bit counters
+    struct alignas(64) Block {
+        uint64_t words[countersPerBlock / 16];
+    };
+
+    std::vector<Block> blocks;
+    size_t probes;
+    size_t expectedKeys;
+    size_t keyCount;
+
+    static uint64_t hash(const std::string& key);
+    Block& blockFor(uint64_t hash);
+    const Block& blockFor(uint64_t hash) const;
+    // counter for the next probe within the block, state starts out as the key hash
+    static size_t nextCounter(uint64_t& state);
+    static size_t counter(const Block& block, size_t index);
+};
+
+#endif //COUNTINGBLOOMFILTER_H
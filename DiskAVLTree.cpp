@@ -0,0 +1,687 @@
+#include "DiskAVLTree.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const char pageFileMagic[4] = {'A', 'V', 'L', 'D'};
+    const uint32_t pageFileVersion = 1;
+    // header fields after the magic and version
+    const size_t headerFieldsOffset = 8;
+    // record bytes before the key: value, height, left, right and the key length
+    const size_t recordKeyOffset = 36;
+    // operator[] pins one page and a rotation reads two more while another is pinned
+    const size_t minCachedPages = 4;
+
+    /*
+     *  openPageFile - open path for reading and writing, creating an empty file first if there is none
+     */
+    std::fstream openPageFile(const std::string& path) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file.is_open()) {
+            std::ofstream create(path, std::ios::binary);
+            create.close();
+            file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        }
+        return file;
+    }
+}
+
+/*
+ * DiskAVLTree constructor - opens or creates the page file. Page 0 holds the header, nodes fill the pages after it
+ *
+ *      params
+ *          path - page file
+ *          memoryBudget - bytes of pages to keep cached
+ *          maxKeyLength - longest key a new file can hold
+ */
+DiskAVLTree::DiskAVLTree(const std::string &path, size_t memoryBudget, size_t maxKeyLength)
+    : file(openPageFile(path)),
+      pool(file, pageSize, memoryBudget / pageSize > minCachedPages ? memoryBudget / pageSize : minCachedPages) {
+    this->opened = this->file.is_open();
+    this->failed = false;
+    this->maxKeyLength = maxKeyLength < pageSize - recordKeyOffset ? maxKeyLength : pageSize - recordKeyOffset;
+    this->root = nullNode;
+    this->treeSize = 0;
+    this->nodeCount = 0;
+    this->freeHead = nullNode;
+    this->indexPinnedPage = nullNode;
+
+    if (this->opened) {
+        if (this->pool.pageCount() == 0) {
+            uint64_t headerPage;
+            if (this->pool.newPage(headerPage) == nullptr) {
+                this->opened = false;
+            }
+            else {
+                this->pool.unpinPage(headerPage, true);
+            }
+        }
+        else {
+            this->opened = readHeader();
+        }
+    }
+
+    //records stay 8 byte aligned so operator[] can hand out a reference to the value
+    this->recordSize = (recordKeyOffset + this->maxKeyLength + 7) / 8 * 8;
+    this->nodesPerPage = pageSize / this->recordSize;
+    if (this->opened) {
+        writeHeader();
+    }
+}
+
+/*
+ * DiskAVLTree destructor - writes everything back so the file can be opened again
+ */
+DiskAVLTree::~DiskAVLTree() {
+    if (this->opened) {
+        flush();
+    }
+}
+
+/*
+ *  good - true while the file is usable
+ */
+bool DiskAVLTree::good() const {
+    return this->opened and !this->failed;
+}
+
+/*
+ *  readHeader - load the tree fields from page 0
+ *
+ *  returns - false if page 0 is not a header this version understands
+ */
+bool DiskAVLTree::readHeader() {
+    char* page = this->pool.fetchPage(0);
+    if (page == nullptr) {
+        return false;
+    }
+    uint32_t version;
+    uint64_t fields[6];
+    std::memcpy(&version, page + sizeof(pageFileMagic), sizeof(version));
+    std::memcpy(fields, page + headerFieldsOffset, sizeof(fields));
+    bool valid = std::memcmp(page, pageFileMagic, sizeof(pageFileMagic)) == 0 and version == pageFileVersion and
+                 fields[0] == pageSize and fields[1] <= pageSize - recordKeyOffset;
+    this->pool.unpinPage(0, false);
+    if (!valid) {
+        return false;
+    }
+
+    this->maxKeyLength = fields[1];
+    this->root = fields[2];
+    this->treeSize = fields[3];
+    this->nodeCount = fields[4];
+    this->freeHead = fields[5];
+    return true;
+}
+
+/*
+ *  writeHeader - store the tree fields in page 0
+ */
+void DiskAVLTree::writeHeader() {
+    char* page = this->pool.fetchPage(0);
+    if (page == nullptr) {
+        this->failed = true;
+        return;
+    }
+    uint64_t fields[6] = {pageSize, this->maxKeyLength, this->root, this->treeSize, this->nodeCount, this->freeHead};
+    std::memcpy(page, pageFileMagic, sizeof(pageFileMagic));
+    std::memcpy(page + sizeof(pageFileMagic), &pageFileVersion, sizeof(pageFileVersion));
+    std::memcpy(page + headerFieldsOffset, fields, sizeof(fields));
+    this->pool.unpinPage(0, true);
+}
+
+/*
+ *  releaseIndexPin - unpin the page of the last operator[] value, it may have been written through
+ */
+void DiskAVLTree::releaseIndexPin() const {
+    if (this->indexPinnedPage != nullNode) {
+        this->pool.unpinPage(this->indexPinnedPage, true);
+        this->indexPinnedPage = nullNode;
+    }
+}
+
+/*
+ *  flush - write the header and every changed page
+ *
+ *  returns - false if a write failed
+ */
+bool DiskAVLTree::flush() {
+    releaseIndexPin();
+    writeHeader();
+    return this->pool.flush() and good();
+}
+
+/*
+ *  pageReads - pages read from the file so far
+ */
+size_t DiskAVLTree::pageReads() const {
+    return this->pool.pageReads();
+}
+
+/*
+ *  pageWrites - pages written to the file so far
+ */
+size_t DiskAVLTree::pageWrites() const {
+    return this->pool.pageWrites();
+}
+
+/*
+ *  pageOf - page holding a node record
+ */
+uint64_t DiskAVLTree::pageOf(uint64_t id) const {
+    return 1 + id / this->nodesPerPage;
+}
+
+/*
+ *  offsetOf - byte offset of a node record within its page
+ */
+size_t DiskAVLTree::offsetOf(uint64_t id) const {
+    return (id % this->nodesPerPage) * this->recordSize;
+}
+
+/*
+ *  readNode - copy a node record out of its page
+ *
+ *  params
+ *      id - node to read
+ *      node - filled with the record
+ *
+ *  returns - false if the page could not be read
+ */
+bool DiskAVLTree::readNode(uint64_t id, DiskNode &node) const {
+    char* page = this->pool.fetchPage(pageOf(id));
+    if (page == nullptr) {
+        this->failed = true;
+        return false;
+    }
+    const char* record = page + offsetOf(id);
+    uint32_t keyLength;
+    std::memcpy(&node.value, record, 8);
+    std::memcpy(&node.height, record + 8, 8);
+    std::memcpy(&node.left, record + 16, 8);
+    std::memcpy(&node.right, record + 24, 8);
+    std::memcpy(&keyLength, record + 32, 4);
+    node.key.assign(record + recordKeyOffset, keyLength);
+    this->pool.unpinPage(pageOf(id), false);
+    return true;
+}
+
+/*
+ *  writeNode - copy a node into its record
+ *
+ *  params
+ *      id - node to write
+ *      node - new contents, key must fit in maxKeyLength
+ */
+void DiskAVLTree::writeNode(uint64_t id, const DiskNode &node) {
+    char* page = this->pool.fetchPage(pageOf(id));
+    if (page == nullptr) {
+        this->failed = true;
+        return;
+    }
+    char* record = page + offsetOf(id);
+    uint32_t keyLength = static_cast<uint32_t>(node.key.size());
+    std::memcpy(record, &node.value, 8);
+    std::memcpy(record + 8, &node.height, 8);
+    std::memcpy(record + 16, &node.left, 8);
+    std::memcpy(record + 24, &node.right, 8);
+    std::memcpy(record + 32, &keyLength, 4);
+    std::memcpy(record + recordKeyOffset, node.key.data(), keyLength);
+    this->pool.unpinPage(pageOf(id), true);
+}
+
+/*
+ *  heightOf - read only the height of a node
+ *
+ *  returns - its height, -1 for nullNode
+ */
+long DiskAVLTree::heightOf(uint64_t id) const {
+    if (id == nullNode) {
+        return -1;
+    }
+    char* page = this->pool.fetchPage(pageOf(id));
+    if (page == nullptr) {
+        this->failed = true;
+        return -1;
+    }
+    size_t height;
+    std::memcpy(&height, page + offsetOf(id) + 8, 8);
+    this->pool.unpinPage(pageOf(id), false);
+    return static_cast<long>(height);
+}
+
+/*
+ *  allocateNode - reuse a freed record or take the next one, adding a page when the last is full
+ *
+ *  returns - id of the record
+ */
+uint64_t DiskAVLTree::allocateNode() {
+    if (this->freeHead != nullNode) {
+        uint64_t id = this->freeHead;
+        DiskNode node;
+        if (readNode(id, node)) {
+            this->freeHead = node.left;
+            return id;
+        }
+    }
+
+    uint64_t id = this->nodeCount++;
+    if (pageOf(id) >= this->pool.pageCount()) {
+        uint64_t newPage;
+        if (this->pool.newPage(newPage) == nullptr) {
+            this->failed = true;
+        }
+        else {
+            this->pool.unpinPage(newPage, true);
+        }
+    }
+    return id;
+}
+
+/*
+ *  freeNode - put a record on the free list, which is linked through the left field
+ */
+void DiskAVLTree::freeNode(uint64_t id) {
+    writeNode(id, {0, 0, this->freeHead, nullNode, ""});
+    this->freeHead = id;
+}
+
+/*
+ *  insert - insert key with value if it is not already present
+ *
+ *  returns - true if key was inserted, false if it was present or a page could not be read or written
+ */
+bool DiskAVLTree::insert(const std::string &key, size_t value) {
+    releaseIndexPin();
+    if (key.size() > this->maxKeyLength) {
+        return false;
+    }
+    bool inserted = false;
+    //failed is sticky, start the call clear so only this inserts own page reads and writes are checked
+    bool failedBefore = this->failed;
+    this->failed = false;
+    this->root = insertNode(this->root, key, value, inserted);
+    bool callFailed = this->failed;
+    this->failed = failedBefore or callFailed;
+    if (!inserted or callFailed) {
+        return false;
+    }
+    this->treeSize++;
+    return true;
+}
+
+/*
+ *  insertNode - recursive insert, nodes are only written back if a link or height changed
+ *
+ *  params
+ *      id - top of the subtree
+ *      key - key being inserted
+ *      value - value for a new node
+ *      inserted - set to true if a node was created
+ *
+ *  returns - top of the subtree afterwards
+ */
+uint64_t DiskAVLTree::insertNode(uint64_t id, const std::string &key, size_t value, bool &inserted) {
+    //Bottom of tree insert
+    if (id == nullNode) {
+        uint64_t newId = allocateNode();
+        writeNode(newId, {value, 0, nullNode, nullNode, key});
+        inserted = true;
+        return newId;
+    }
+
+    DiskNode node;
+    if (!readNode(id, node)) {
+        return id;
+    }
+    int compare = key.compare(node.key);
+    if (compare == 0) {
+        return id;
+    }
+
+    uint64_t& childLink = compare > 0 ? node.right : node.left;
+    uint64_t child = insertNode(childLink, key, value, inserted);
+    if (!inserted) {
+        return id;
+    }
+    bool linkChanged = child != childLink;
+    childLink = child;
+    return balanceNode(id, node, linkChanged);
+}
+
+/*
+ *  remove - remove key from the tree
+ *
+ *  returns - true if key was removed, false if it was missing or a page could not be read or written
+ */
+bool DiskAVLTree::remove(const std::string &key) {
+    releaseIndexPin();
+    bool removed = false;
+    //the key only counts as gone once every page the removal touched was read and written
+    bool failedBefore = this->failed;
+    this->failed = false;
+    this->root = remove(this->root, key, removed);
+    bool callFailed = this->failed;
+    this->failed = failedBefore or callFailed;
+    if (!removed or callFailed) {
+        return false;
+    }
+    this->treeSize--;
+    return true;
+}
+
+/*
+ *  remove - recursive helper. A node with two children takes the key and value of the smallest node on its right,
+ *      which is freed instead
+ *
+ *  params
+ *      id - top of the subtree
+ *      key - key to remove
+ *      removed - set to true if key was found
+ *
+ *  returns - top of the subtree afterwards
+ */
+uint64_t DiskAVLTree::remove(uint64_t id, const std::string &key, bool &removed) {
+    DiskNode node;
+    if (id == nullNode or !readNode(id, node)) {
+        return id;
+    }
+
+    int compare = key.compare(node.key);
+    if (compare != 0) {
+        uint64_t& childLink = compare > 0 ? node.right : node.left;
+        uint64_t child = remove(childLink, key, removed);
+        if (!removed) {
+            return id;
+        }
+        bool linkChanged = child != childLink;
+        childLink = child;
+        return balanceNode(id, node, linkChanged);
+    }
+
+    removed = true;
+    if (node.left == nullNode or node.right == nullNode) {
+        uint64_t child = node.left == nullNode ? node.right : node.left;
+        freeNode(id);
+        return child;
+    }
+
+    uint64_t smallest;
+    node.right = detachSmallest(node.right, smallest);
+    DiskNode successor;
+    if (readNode(smallest, successor)) {
+        node.key = std::move(successor.key);
+        node.value = successor.value;
+    }
+    freeNode(smallest);
+    return balanceNode(id, node, true);
+}
+
+/*
+ *  detachSmallest - unlink the leftmost node under id, rebalancing on the way back up
+ *
+ *  params
+ *      id - top of the subtree
+ *      smallest - set to the unlinked node
+ *
+ *  returns - top of the subtree afterwards
+ */
+uint64_t DiskAVLTree::detachSmallest(uint64_t id, uint64_t &smallest) {
+    DiskNode node;
+    if (!readNode(id, node)) {
+        smallest = id;
+        return nullNode;
+    }
+    if (node.left == nullNode) {
+        smallest = id;
+        return node.right;
+    }
+    uint64_t child = detachSmallest(node.left, smallest);
+    bool linkChanged = child != node.left;
+    node.left = child;
+    return balanceNode(id, node, linkChanged);
+}
+
+/*
+ *  updateHeight - recompute a nodes height from its children
+ */
+void DiskAVLTree::updateHeight(DiskNode &node) const {
+    long leftHeight = heightOf(node.left);
+    long rightHeight = heightOf(node.right);
+    node.height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+}
+
+/*
+ *  balanceNode - update node after something below it changed, rotate if it is out of balance and write it back.
+ *      A node whose links and height are unchanged is not written so its page stays clean
+ *
+ *  params
+ *      id - node being balanced
+ *      node - its copy with the new child links
+ *      linkChanged - true if a child link of node is different from the record
+ *
+ *  returns - the node now at the top of the subtree
+ */
+uint64_t DiskAVLTree::balanceNode(uint64_t id, DiskNode &node, bool linkChanged) {
+    long balance = heightOf(node.left) - heightOf(node.right);
+
+    //left side is too tall
+    if (balance > 1) {
+        DiskNode left;
+        if (readNode(node.left, left) and heightOf(left.left) < heightOf(left.right)) {
+            node.left = leftRotate(node.left, left);
+        }
+        return rightRotate(id, node);
+    }
+    //right side is too tall
+    if (balance < -1) {
+        DiskNode right;
+        if (readNode(node.right, right) and heightOf(right.right) < heightOf(right.left)) {
+            node.right = rightRotate(node.right, right);
+        }
+        return leftRotate(id, node);
+    }
+
+    size_t oldHeight = node.height;
+    updateHeight(node);
+    if (linkChanged or node.height != oldHeight) {
+        writeNode(id, node);
+    }
+    return id;
+}
+
+/*
+ *  rightRotate - rotate the left child of node up into its place and write both back
+ *
+ *  returns - id of the old left child, now on top
+ */
+uint64_t DiskAVLTree::rightRotate(uint64_t id, DiskNode &node) {
+    uint64_t leftId = node.left;
+    DiskNode left;
+    if (!readNode(leftId, left)) {
+        writeNode(id, node);
+        return id;
+    }
+
+    node.left = left.right;
+    updateHeight(node);
+    writeNode(id, node);
+
+    left.right = id;
+    updateHeight(left);
+    writeNode(leftId, left);
+    return leftId;
+}
+
+/*
+ *  leftRotate - rotate the right child of node up into its place and write both back
+ *
+ *  returns - id of the old right child, now on top
+ */
+uint64_t DiskAVLTree::leftRotate(uint64_t id, DiskNode &node) {
+    uint64_t rightId = node.right;
+    DiskNode right;
+    if (!readNode(rightId, right)) {
+        writeNode(id, node);
+        return id;
+    }
+
+    node.right = right.left;
+    updateHeight(node);
+    writeNode(id, node);
+
+    right.left = id;
+    updateHeight(right);
+    writeNode(rightId, right);
+    return rightId;
+}
+
+/*
+ *  findNode - walk down comparing keys in place in the cached pages
+ *
+ *  returns - id of the node holding key or nullNode
+ */
+uint64_t DiskAVLTree::findNode(const std::string &key) const {
+    uint64_t id = this->root;
+    while (id != nullNode) {
+        char* page = this->pool.fetchPage(pageOf(id));
+        if (page == nullptr) {
+            this->failed = true;
+            return nullNode;
+        }
+        const char* record = page + offsetOf(id);
+        uint32_t keyLength;
+        std::memcpy(&keyLength, record + 32, 4);
+        int compare = key.compare(0, std::string::npos, record + recordKeyOffset, keyLength);
+        uint64_t next = id;
+        if (compare > 0) {
+            std::memcpy(&next, record + 24, 8);
+        }
+        else if (compare < 0) {
+            std::memcpy(&next, record + 16, 8);
+        }
+        this->pool.unpinPage(pageOf(id), false);
+        if (compare == 0) {
+            return id;
+        }
+        id = next;
+    }
+    return nullNode;
+}
+
+/*
+ *  contains - whether key is in the tree
+ */
+bool DiskAVLTree::contains(const std::string &key) const {
+    releaseIndexPin();
+    return findNode(key) != nullNode;
+}
+
+/*
+ *  get - value stored for key
+ *
+ *  returns - the value or nullopt if key is not in the tree
+ */
+std::optional<size_t> DiskAVLTree::get(const std::string &key) const {
+    releaseIndexPin();
+    uint64_t id = findNode(key);
+    DiskNode node;
+    if (id == nullNode or !readNode(id, node)) {
+        return std::nullopt;
+    }
+    return node.value;
+}
+
+/*
+ *  operator[] - value of key, inserting 0 first if it is missing. The page holding the value stays pinned until
+ *      the next call so writes through the reference reach the file
+ *
+ *  returns - reference to the value. Throws std::length_error if key is longer than maxKeyLength and
+ *      std::runtime_error if its page could not be read or written
+ */
+size_t& DiskAVLTree::operator[](const std::string &key) {
+    releaseIndexPin();
+    if (key.size() > this->maxKeyLength) {
+        throw std::length_error("DiskAVLTree: key longer than maxKeyLength");
+    }
+    uint64_t id = findNode(key);
+    if (id == nullNode and insert(key, 0)) {
+        id = findNode(key);
+    }
+    char* page = id == nullNode ? nullptr : this->pool.fetchPage(pageOf(id));
+    if (page == nullptr) {
+        this->failed = true;
+        throw std::runtime_error("DiskAVLTree: could not read or write the page for key");
+    }
+    this->indexPinnedPage = pageOf(id);
+    return *reinterpret_cast<size_t*>(page + offsetOf(id));
+}
+
+/*
+ *  findRange - values of every key between lowKey and highKey in key order
+ */
+std::vector<std::string> DiskAVLTree::findRange(const std::string &lowKey, const std::string &highKey) const {
+    releaseIndexPin();
+    std::vector<std::string> returnVector;
+    rangeHelper(lowKey, highKey, returnVector, this->root);
+    return returnVector;
+}
+
+/*
+ *  rangeHelper - in order walk that skips subtrees outside the range
+ */
+void DiskAVLTree::rangeHelper(const std::string &lowKey, const std::string &highKey, std::vector<std::string> &returnVector, uint64_t id) const {
+    DiskNode node;
+    if (id == nullNode or !readNode(id, node)) {
+        return;
+    }
+    if (node.key > lowKey) {
+        rangeHelper(lowKey, highKey, returnVector, node.left);
+    }
+    if (node.key >= lowKey and node.key <= highKey) {
+        returnVector.push_back(std::to_string(node.value));
+    }
+    if (node.key < highKey) {
+        rangeHelper(lowKey, highKey, returnVector, node.right);
+    }
+}
+
+/*
+ *  keys - values of every key in key order, like AVLTree::keys
+ */
+std::vector<std::string> DiskAVLTree::keys() const {
+    releaseIndexPin();
+    std::vector<std::string> returnVector;
+    returnVector.reserve(this->treeSize);
+    keysHelper(this->root, returnVector);
+    return returnVector;
+}
+
+/*
+ *  keysHelper - in order walk adding each value
+ */
+void DiskAVLTree::keysHelper(uint64_t id, std::vector<std::string> &returnVector) const {
+    DiskNode node;
+    if (id == nullNode or !readNode(id, node)) {
+        return;
+    }
+    keysHelper(node.left, returnVector);
+    returnVector.push_back(std::to_string(node.value));
+    keysHelper(node.right, returnVector);
+}
+
+/*
+ *  size - number of keys
+ */
+size_t DiskAVLTree::size() const {
+    return this->treeSize;
+}
+
+/*
+ *  getHeight - height of the root, 0 for an empty tree
+ */
+size_t DiskAVLTree::getHeight() const {
+    long height = heightOf(this->root);
+    return height < 0 ? 0 : static_cast<size_t>(height);
+}
@@ -0,0 +1,112 @@
+/**
+ * DiskAVLTree.h
+ *
+ * AVL tree whose nodes live in fixed-size pages of a file instead of on the heap, for data sets larger than memory.
+ * Pages are cached by a BufferPool within a memory budget. Every call walks down from the root, so the upper levels
+ * stay in the cache and only the cold lower levels are read from the file. Offers the same calls as AVLTree for
+ * keys up to maxKeyLength bytes.
+ */
+
+#ifndef DISKAVLTREE_H
+#define DISKAVLTREE_H
+#include "BufferPool.h"
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+class DiskAVLTree {
+public:
+    static constexpr size_t pageSize = 4096;
+
+    // opens the tree stored in path or creates it there. memoryBudget bytes of pages are cached. maxKeyLength only
+    // matters for a new file, an existing one keeps its own
+    DiskAVLTree(const std::string& path, size_t memoryBudget, size_t maxKeyLength = 64);
+    // writes back everything still cached
+    ~DiskAVLTree();
+    DiskAVLTree(const DiskAVLTree& other) = delete;
+    void operator=(const DiskAVLTree& other) = delete;
+
+    // false if the file could not be opened, is not a tree file or a read or write failed
+    bool good() const;
+    // false if key is already present, longer than maxKeyLength or a page could not be read or written
+    bool insert(const std::string& key, size_t value);
+    bool contains(const std::string& key) const;
+    std::optional<size_t> get(const std::string& key) const;
+    // inserts key with value 0 if it is missing. The reference points into a pinned page and is valid until the
+    // next call on the tree. Throws std::length_error for a key longer than maxKeyLength and std::runtime_error
+    // if the page can not be read or written
+    size_t& operator[](const std::string& key);
+    std::vector<std::string> findRange(const std::string& lowKey, const std::string& highKey) const;
+    std::vector<std::string> keys() const;
+    size_t size() const;
+    size_t getHeight() const;
+    bool remove(const std::string& key);
+    // writes the header and every changed page to the file
+    bool flush();
+
+    // pages read from and written to the file, for sizing the memory budget
+    size_t pageReads() const;
+    size_t pageWrites() const;
+
+private:
+    // node ids count records from the first node page, nullNode is a missing child
+    static constexpr uint64_t nullNode = UINT64_MAX;
+
+    // copy of a node record. On disk a record is value, height, left, right, key length and then the key bytes
+    struct DiskNode {
+        size_t value;
+        size_t height;
+        uint64_t left;
+        uint64_t right;
+        std::string key;
+    };
+
+    std::fstream file;
+    // pages are only read through the cache so lookups can stay const
+    mutable BufferPool pool;
+    bool opened;
+    mutable bool failed;
+    size_t maxKeyLength;
+    size_t recordSize;
+    size_t nodesPerPage;
+    uint64_t root;
+    size_t treeSize;
+    // next id never handed out and the head of the list of freed ids
+    uint64_t nodeCount;
+    uint64_t freeHead;
+    // page kept pinned for the reference returned by operator[], nullNode if none
+    mutable uint64_t indexPinnedPage;
+
+    bool readHeader();
+    void writeHeader();
+    void releaseIndexPin() const;
+
+    /* Helper methods for node records */
+    uint64_t pageOf(uint64_t id) const;
+    size_t offsetOf(uint64_t id) const;
+    bool readNode(uint64_t id, DiskNode& node) const;
+    void writeNode(uint64_t id, const DiskNode& node);
+    // height of the node, -1 for nullNode
+    long heightOf(uint64_t id) const;
+    uint64_t allocateNode();
+    void freeNode(uint64_t id);
+
+    // each returns the id of the node now at the top of the subtree it was given
+    uint64_t insertNode(uint64_t id, const std::string& key, size_t value, bool& inserted);
+    uint64_t remove(uint64_t id, const std::string& key, bool& removed);
+    // unlinks the smallest node under id into smallest
+    uint64_t detachSmallest(uint64_t id, uint64_t& smallest);
+    // recomputes node's height, rotates if it is out of balance and writes back what changed
+    uint64_t balanceNode(uint64_t id, DiskNode& node, bool linkChanged);
+    uint64_t rightRotate(uint64_t id, DiskNode& node);
+    uint64_t leftRotate(uint64_t id, DiskNode& node);
+    void updateHeight(DiskNode& node) const;
+
+    uint64_t findNode(const std::string& key) const;
+    void rangeHelper(const std::string& lowKey, const std::string& highKey, std::vector<std::string>& returnVector, uint64_t id) const;
+    void keysHelper(uint64_t id, std::vector<std::string>& returnVector) const;
+};
+
+#endif //DISKAVLTREE_H
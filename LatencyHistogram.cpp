@@ -0,0 +1,186 @@
+#include "LatencyHistogram.h"
+
+#include <bit>
+
+/*
+ *  LatencySnapshot::percentile - walk the buckets until fraction of the calls are covered
+ *
+ *  params
+ *      fraction - 0.5 for p50, 0.99 for p99 and so on
+ *
+ *  returns - upper edge of that bucket, never more than the largest value seen
+ */
+uint64_t LatencySnapshot::percentile(double fraction) const {
+    if (this->count == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(this->count));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < this->counts.size(); bucket++) {
+        seen += this->counts[bucket];
+        if (seen > target) {
+            uint64_t upper = LatencyHistogram::bucketUpperBound(bucket);
+            return upper < this->maxNanoseconds ? upper : this->maxNanoseconds;
+        }
+    }
+    return this->maxNanoseconds;
+}
+
+/*
+ *  LatencySnapshot::meanNanoseconds - average sampled latency, 0 if nothing was sampled
+ */
+double LatencySnapshot::meanNanoseconds() const {
+    return this->count == 0 ? 0 : static_cast<double>(this->totalNanoseconds) / static_cast<double>(this->count);
+}
+
+/*
+ *  LatencyHistogram constructor - empty histogram
+ *
+ *      params
+ *          sampleEvery - time one call in this many, 0 and 1 time every call
+ */
+LatencyHistogram::LatencyHistogram(size_t sampleEvery) {
+    setSampleEvery(sampleEvery);
+    reset();
+}
+
+/*
+ *  setSampleEvery - change the sampling rate, takes effect for the next call
+ */
+void LatencyHistogram::setSampleEvery(size_t sampleEvery) {
+    this->sampleEvery = sampleEvery == 0 ? 1 : sampleEvery;
+}
+
+/*
+ *  sample - decide whether to time this call with a per thread xorshift generator, no shared state is touched
+ */
+bool LatencyHistogram::sample() const {
+    if (this->sampleEvery == 1) {
+        return true;
+    }
+    thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ threadShard();
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state % this->sampleEvery == 0;
+}
+
+/*
+ *  record - count one latency in the calling threads shard
+ *
+ *  params
+ *      nanoseconds - how long the call took
+ */
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    Shard& shard = this->shards[threadShard()];
+    shard.counts[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    shard.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    //threads past shardCount share a shard so the max needs a compare and swap
+    uint64_t max = shard.maxNanoseconds.load(std::memory_order_relaxed);
+    while (nanoseconds > max and !shard.maxNanoseconds.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+/*
+ *  snapshot - merge the shards into one set of counts
+ *
+ *  params
+ *      reset - take the counts out of the histogram so the next snapshot starts a new interval
+ *
+ *  returns - the merged counts
+ */
+LatencySnapshot LatencyHistogram::snapshot(bool reset) {
+    LatencySnapshot result;
+    result.counts.assign(bucketCount, 0);
+    result.sampleEvery = this->sampleEvery;
+
+    for (Shard& shard : this->shards) {
+        for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+            result.counts[bucket] += reset ? shard.counts[bucket].exchange(0, std::memory_order_relaxed)
+                                           : shard.counts[bucket].load(std::memory_order_relaxed);
+        }
+        uint64_t max = reset ? shard.maxNanoseconds.exchange(0, std::memory_order_relaxed)
+                             : shard.maxNanoseconds.load(std::memory_order_relaxed);
+        result.maxNanoseconds = max > result.maxNanoseconds ? max : result.maxNanoseconds;
+        result.totalNanoseconds += reset ? shard.totalNanoseconds.exchange(0, std::memory_order_relaxed)
+                                         : shard.totalNanoseconds.load(std::memory_order_relaxed);
+    }
+    //the count is summed from the buckets so it always matches them, even while other threads record
+    for (uint64_t bucketCalls : result.counts) {
+        result.count += bucketCalls;
+    }
+    return result;
+}
+
+/*
+ *  reset - zero every shard
+ */
+void LatencyHistogram::reset() {
+    for (Shard& shard : this->shards) {
+        for (std::atomic<uint64_t>& bucket : shard.counts) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        shard.totalNanoseconds.store(0, std::memory_order_relaxed);
+        shard.maxNanoseconds.store(0, std::memory_order_relaxed);
+    }
+}
+
+/*
+ *  bucketFor - values under subBuckets map to themselves. Larger values use their power of two and the next
+ *      four bits below the top one
+ */
+size_t LatencyHistogram::bucketFor(uint64_t nanoseconds) {
+    if (nanoseconds < subBuckets) {
+        return nanoseconds;
+    }
+    size_t exponent = std::bit_width(nanoseconds) - 1;
+    if (exponent >= maxExponent) {
+        return bucketCount - 1;
+    }
+    size_t sub = (nanoseconds >> (exponent - 4)) & (subBuckets - 1);
+    return subBuckets + (exponent - 4) * subBuckets + sub;
+}
+
+/*
+ *  bucketUpperBound - inverse of bucketFor, the largest value mapped to bucket
+ */
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket < subBuckets) {
+        return bucket;
+    }
+    if (bucket >= bucketCount - 1) {
+        return UINT64_MAX;
+    }
+    size_t exponent = (bucket - subBuckets) / subBuckets + 4;
+    uint64_t sub = (bucket - subBuckets) % subBuckets;
+    return ((subBuckets + sub + 1) << (exponent - 4)) - 1;
+}
+
+/*
+ *  threadShard - shard picked for the calling thread the first time it records
+ */
+size_t LatencyHistogram::threadShard() {
+    static std::atomic<size_t> nextThread{0};
+    thread_local size_t shard = nextThread.fetch_add(1, std::memory_order_relaxed) % shardCount;
+    return shard;
+}
+
+/*
+ *  LatencyTimer constructor - start the clock if histogram wants this call
+ */
+LatencyTimer::LatencyTimer(LatencyHistogram *histogram) {
+    this->histogram = (histogram != nullptr and histogram->sample()) ? histogram : nullptr;
+    if (this->histogram != nullptr) {
+        this->start = std::chrono::steady_clock::now();
+    }
+}
+
+/*
+ *  LatencyTimer destructor - record the time since the constructor
+ */
+LatencyTimer::~LatencyTimer() {
+    if (this->histogram != nullptr) {
+        auto elapsed = std::chrono::steady_clock::now() - this->start;
+        this->histogram->record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ * LatencyHistogram.h
+ *
+ * Log-linear (HDR style) latency histogram. Values below 16ns get their own bucket, above that every power of two
+ * is split into 16 buckets so any value is known to within 1/16 of itself. Each thread counts into one of a few
+ * shards with relaxed atomics and the shards are summed when a snapshot is taken.
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+struct LatencySnapshot {
+    // counts per bucket, see LatencyHistogram::bucketFor
+    std::vector<uint64_t> counts;
+    // number of sampled calls
+    uint64_t count = 0;
+    uint64_t totalNanoseconds = 0;
+    uint64_t maxNanoseconds = 0;
+    // one call in sampleEvery was timed
+    size_t sampleEvery = 1;
+
+    // highest latency in the bucket holding the given fraction (0.5 for p50) of calls, 0 if nothing was sampled
+    uint64_t percentile(double fraction) const;
+    double meanNanoseconds() const;
+};
+
+class LatencyHistogram {
+public:
+    static constexpr size_t subBuckets = 16;
+    // values from 2^maxExponent nanoseconds (about 18 minutes) up land in the last bucket, which holds nothing else
+    static constexpr size_t maxExponent = 40;
+    static constexpr size_t bucketCount = subBuckets + (maxExponent - 4) * subBuckets + 1;
+    static constexpr size_t shardCount = 8;
+
+    // times one call in sampleEvery, chosen at random so calls that alternate in a pattern are not skewed
+    explicit LatencyHistogram(size_t sampleEvery = 1);
+    void setSampleEvery(size_t sampleEvery);
+    // true if the calling thread should time this call
+    bool sample() const;
+    void record(uint64_t nanoseconds);
+    // sums the shards, reset zeroes them in the same pass so no call is counted twice or lost
+    LatencySnapshot snapshot(bool reset = false);
+    void reset();
+
+    static size_t bucketFor(uint64_t nanoseconds);
+    // largest value that falls in bucket
+    static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[bucketCount];
+        std::atomic<uint64_t> totalNanoseconds;
+        std::atomic<uint64_t> maxNanoseconds;
+    };
+
+    size_t sampleEvery;
+    Shard shards[shardCount];
+
+    // shard of the calling thread, threads are spread over the shards in the order they first record
+    static size_t threadShard();
+};
+
+// times its own lifetime into histogram when the call is sampled, does nothing for nullptr
+class LatencyTimer {
+public:
+    explicit LatencyTimer(LatencyHistogram* histogram);
+    ~LatencyTimer();
+    LatencyTimer(const LatencyTimer& other) = delete;
+    void operator=(const LatencyTimer& other) = delete;
+
+private:
+    LatencyHistogram* histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif //LATENCYHISTOGRAM_H
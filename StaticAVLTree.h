@@ -0,0 +1,242 @@
+/**
+ * StaticAVLTree.h
+ *
+ * Read only tree for key sets known at compile time (command names, config keys). The tree is built by a
+ * constexpr constructor into one flat array in breadth first (Eytzinger) order: the root is slot 0 and the
+ * children of slot i are 2i + 1 and 2i + 2, so the tree is perfectly balanced and lookups are a short loop over
+ * an array with no pointers to chase. Declared constexpr the whole tree lives in the binary and costs nothing
+ * at startup.
+ *
+ *     constexpr StaticAVLTree commands({{"add", 1}, {"list", 2}, {"remove", 3}});
+ *     static_assert(commands.contains("list"));
+ */
+
+#ifndef STATICAVLTREE_H
+#define STATICAVLTREE_H
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+template <size_t N>
+class StaticAVLTree {
+public:
+    using Entry = std::pair<std::string_view, size_t>;
+
+    // builds the tree from entries, like inserting them in order into an AVLTree a repeated key keeps its first value
+    constexpr StaticAVLTree(const Entry (&entries)[N]);
+
+    constexpr bool contains(std::string_view key) const;
+    constexpr std::optional<size_t> get(std::string_view key) const;
+    // values of all keys lowKey <= key <= highKey in key order
+    std::vector<std::string> findRange(std::string_view lowKey, std::string_view highKey) const;
+    // values of every key in key order, like AVLTree::keys
+    std::vector<std::string> keys() const;
+    constexpr size_t size() const;
+    constexpr size_t getHeight() const;
+
+private:
+    // breadth first order, only the first treeSize slots are used
+    std::array<Entry, N> nodes;
+    size_t treeSize;
+
+    // slot of key or treeSize if it is missing
+    constexpr size_t findSlot(std::string_view key) const;
+    // fills the subtree rooted at slot with sorted entries starting at next, returns the next unused sorted index
+    constexpr size_t buildHelper(const std::array<Entry, N>& sorted, size_t next, size_t slot);
+    void rangeHelper(std::string_view lowKey, std::string_view highKey, std::vector<std::string>& returnVector, size_t slot) const;
+    void keysHelper(size_t slot, std::vector<std::string>& returnVector) const;
+};
+
+template <size_t N>
+StaticAVLTree(const std::pair<std::string_view, size_t> (&)[N]) -> StaticAVLTree<N>;
+
+/*
+ * StaticAVLTree - sorts entries, drops repeated keys and lays the result out breadth first
+ *
+ *  params
+ *      entries - key value pairs in any order
+ */
+template <size_t N>
+constexpr StaticAVLTree<N>::StaticAVLTree(const Entry (&entries)[N]) : nodes{}, treeSize(0) {
+    //std::sort is constexpr but not stable, sorting positions with ties broken by position keeps equal keys in
+    //their original order so the first one can be kept
+    std::array<size_t, N> order{};
+    for (size_t i = 0; i < N; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&entries](size_t a, size_t b) {
+        return entries[a].first < entries[b].first or (entries[a].first == entries[b].first and a < b);
+    });
+    std::array<Entry, N> sorted{};
+    for (size_t i = 0; i < N; i++) {
+        sorted[i] = entries[order[i]];
+    }
+
+    //keep the first of each run of equal keys
+    for (size_t i = 0; i < N; i++) {
+        if (this->treeSize == 0 or sorted[this->treeSize - 1].first != sorted[i].first) {
+            sorted[this->treeSize] = sorted[i];
+            this->treeSize++;
+        }
+    }
+
+    //an in order walk over the breadth first slots visits them in key order
+    buildHelper(sorted, 0, 0);
+}
+
+/*
+ * buildHelper - fills the subtree rooted at slot with the next sorted entries in order
+ *
+ *  params
+ *      sorted - entries sorted by key with no repeats
+ *      next - index of the next sorted entry to place
+ *      slot - root of the subtree being filled
+ *
+ *  returns - index of the next sorted entry after this subtree
+ */
+template <size_t N>
+constexpr size_t StaticAVLTree<N>::buildHelper(const std::array<Entry, N>& sorted, size_t next, size_t slot) {
+    if (slot >= this->treeSize) {
+        return next;
+    }
+    next = buildHelper(sorted, next, 2 * slot + 1);
+    this->nodes[slot] = sorted[next];
+    return buildHelper(sorted, next + 1, 2 * slot + 2);
+}
+
+/*
+ * findSlot - walks down from the root
+ *
+ *  params
+ *      key - key being looked for
+ *
+ *  returns - slot holding key, treeSize if key is not in the tree
+ */
+template <size_t N>
+constexpr size_t StaticAVLTree<N>::findSlot(std::string_view key) const {
+    size_t slot = 0;
+    while (slot < this->treeSize) {
+        if (key == this->nodes[slot].first) {
+            return slot;
+        }
+        slot = key < this->nodes[slot].first ? 2 * slot + 1 : 2 * slot + 2;
+    }
+    return this->treeSize;
+}
+
+/*
+ * contains - whether key is in the tree
+ */
+template <size_t N>
+constexpr bool StaticAVLTree<N>::contains(std::string_view key) const {
+    return findSlot(key) != this->treeSize;
+}
+
+/*
+ * get - value of key
+ *
+ *  returns - the value or nullopt if key is not in the tree
+ */
+template <size_t N>
+constexpr std::optional<size_t> StaticAVLTree<N>::get(std::string_view key) const {
+    size_t slot = findSlot(key);
+    if (slot == this->treeSize) {
+        return std::nullopt;
+    }
+    return this->nodes[slot].second;
+}
+
+/*
+ * findRange - values of every key between lowKey and highKey
+ *
+ *  params
+ *      lowKey - low range
+ *      highKey - high range
+ *
+ *  returns - the values as strings in key order
+ */
+template <size_t N>
+std::vector<std::string> StaticAVLTree<N>::findRange(std::string_view lowKey, std::string_view highKey) const {
+    std::vector<std::string> returnVector;
+    rangeHelper(lowKey, highKey, returnVector, 0);
+    return returnVector;
+}
+
+/*
+ * rangeHelper - in order walk that skips subtrees outside the range
+ *
+ *  params
+ *      lowKey - low range
+ *      highKey - high range
+ *      returnVector - vector values are being added to
+ *      slot - root of the subtree being walked
+ */
+template <size_t N>
+void StaticAVLTree<N>::rangeHelper(std::string_view lowKey, std::string_view highKey, std::vector<std::string>& returnVector, size_t slot) const {
+    if (slot >= this->treeSize) {
+        return;
+    }
+    const Entry& node = this->nodes[slot];
+    if (node.first > lowKey) {
+        rangeHelper(lowKey, highKey, returnVector, 2 * slot + 1);
+    }
+    if (node.first >= lowKey and node.first <= highKey) {
+        returnVector.push_back(std::to_string(node.second));
+    }
+    if (node.first < highKey) {
+        rangeHelper(lowKey, highKey, returnVector, 2 * slot + 2);
+    }
+}
+
+/*
+ * keys - values of every key in key order
+ *
+ *  returns - the values as strings
+ */
+template <size_t N>
+std::vector<std::string> StaticAVLTree<N>::keys() const {
+    std::vector<std::string> returnVector;
+    returnVector.reserve(this->treeSize);
+    keysHelper(0, returnVector);
+    return returnVector;
+}
+
+/*
+ * keysHelper - in order walk adding each value to returnVector
+ */
+template <size_t N>
+void StaticAVLTree<N>::keysHelper(size_t slot, std::vector<std::string>& returnVector) const {
+    if (slot >= this->treeSize) {
+        return;
+    }
+    keysHelper(2 * slot + 1, returnVector);
+    returnVector.push_back(std::to_string(this->nodes[slot].second));
+    keysHelper(2 * slot + 2, returnVector);
+}
+
+/*
+ * size - number of distinct keys
+ */
+template <size_t N>
+constexpr size_t StaticAVLTree<N>::size() const {
+    return this->treeSize;
+}
+
+/*
+ * getHeight - hops from the root to the deepest node, the last level is the only one that can be partly filled
+ */
+template <size_t N>
+constexpr size_t StaticAVLTree<N>::getHeight() const {
+    size_t height = 0;
+    while ((size_t{2} << height) - 1 < this->treeSize) {
+        height++;
+    }
+    return height;
+}
+
+#endif //STATICAVLTREE_H
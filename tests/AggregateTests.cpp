@@ -0,0 +1,97 @@
+/**
+ * AggregateTests.cpp
+ */
+
+#include <map>
+#include <random>
+#include <string>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+// sum of the values of model with lowKey <= key <= highKey
+static size_t modelSum(const std::map<std::string, size_t>& model, const std::string& lowKey, const std::string& highKey) {
+    size_t sum = 0;
+    for (auto it = model.lower_bound(lowKey); it != model.end() and it->first <= highKey; ++it) {
+        sum += it->second;
+    }
+    return sum;
+}
+
+TEST(Aggregate, InvariantsAfterRandomOps) {
+    std::mt19937 rng(26);
+    AVLTree tree;
+    tree.setAggregate(AVLTree::Aggregate::sum());
+    std::map<std::string, size_t> model;
+    for (int i = 0; i < 20000; i++) {
+        std::string key = std::to_string(rng() % 3000);
+        if (rng() % 3 != 0) {
+            size_t value = rng() % 1000;
+            bool inserted = tree.insert(key, value);
+            CHECK(inserted == (model.count(key) == 0));
+            model.emplace(key, value);
+        }
+        else {
+            CHECK(tree.remove(key) == (model.erase(key) == 1));
+        }
+        if (i % 1000 == 0) {
+            CHECK(tree.checkInvariants());
+        }
+    }
+    CHECK(tree.checkInvariants());
+    CHECK(tree.size() == model.size());
+}
+
+TEST(Aggregate, RangeSumMatchesModel) {
+    std::mt19937 rng(2600);
+    AVLTree tree;
+    tree.setAggregate(AVLTree::Aggregate::sum());
+    std::map<std::string, size_t> model;
+    for (int i = 0; i < 5000; i++) {
+        std::string key = std::to_string(rng() % 10000);
+        size_t value = rng() % 1000;
+        if (tree.insert(key, value)) {
+            model[key] = value;
+        }
+    }
+    for (int i = 0; i < 200; i++) {
+        std::string lowKey = std::to_string(rng() % 10000);
+        std::string highKey = std::to_string(rng() % 10000);
+        if (highKey < lowKey) {
+            std::swap(lowKey, highKey);
+        }
+        CHECK(tree.aggregateRange(lowKey, highKey) == modelSum(model, lowKey, highKey));
+    }
+    CHECK(tree.aggregateRange("b", "a") == 0);
+}
+
+TEST(Aggregate, MinMaxAndCopies) {
+    AVLTree tree;
+    for (size_t i = 0; i < 100; i++) {
+        tree.insert("k" + std::to_string(100 + i), i * 7 % 101);
+    }
+    tree.setAggregate(AVLTree::Aggregate::max());
+    CHECK(tree.checkInvariants());
+    CHECK(tree.aggregateRange("k100", "k199") == 100);
+    tree.setAggregate(AVLTree::Aggregate::min());
+    CHECK(tree.aggregateRange("k101", "k199") == 1);
+
+    AVLTree copy(tree);
+    CHECK(copy.checkInvariants());
+    CHECK(copy.aggregateRange("k101", "k199") == 1);
+    AVLTree assigned;
+    assigned = tree;
+    CHECK(assigned.checkInvariants());
+    CHECK(assigned.aggregateRange("k100", "k199") == 0);
+}
+
+TEST(Aggregate, ReferenceWritesRefreshAggregate) {
+    AVLTree tree;
+    tree.setAggregate(AVLTree::Aggregate::sum());
+    tree.insert("a", 1);
+    tree.insert("b", 2);
+    tree.update("a", [](size_t value) { return value + 10; });
+    CHECK(tree.aggregateRange("a", "b") == 13);
+    tree.upsert("c", 5, [](size_t value) { return value; });
+    CHECK(tree.aggregateRange("a", "c") == 18);
+    CHECK(tree.checkInvariants());
+}
@@ -0,0 +1,177 @@
+/**
+ * ChangeFeedTests.cpp
+ */
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+static const size_t keySpace = 300;
+
+// true if both trees hold the same value (or nothing) for every key the tests use
+static bool sameContents(const AVLTree& a, const AVLTree& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < keySpace; i++) {
+        std::string key = "k" + std::to_string(i);
+        if (a.get(key) != b.get(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// brings follower up to date with leader in batches of batchSize, copying leader afresh if the feed fell behind.
+// returns false if a copy was needed
+static bool sync(const AVLTree& leader, AVLTree& follower, size_t batchSize) {
+    while (follower.appliedChangeSequence() < leader.changeSequence()) {
+        std::vector<AVLTree::ChangeEvent> events;
+        if (!leader.readChanges(follower.appliedChangeSequence(), batchSize, events)) {
+            follower = leader;
+            return false;
+        }
+        if (events.empty()) {
+            break;
+        }
+        CHECK(follower.applyChanges(events));
+    }
+    return true;
+}
+
+TEST(ChangeFeed, ReferenceWritesAfterARead) {
+    for (bool coalesce : {false, true}) {
+        AVLTree leader;
+        leader.setChangeFeed(100, coalesce);
+        AVLTree follower(leader);
+
+        leader["a"] = 1;
+        CHECK(sync(leader, follower, 100));
+        CHECK(follower.get("a") == 1);
+        leader["a"] = 2;
+        CHECK(sync(leader, follower, 100));
+        CHECK(follower.get("a") == 2);
+
+        leader.try_emplace("b", 1).first = 5;
+        CHECK(sync(leader, follower, 100));
+        leader.try_emplace("b", 1).first = 6;
+        leader.upsert("c", 1, [](size_t value) { return value; }) = 7;
+        CHECK(sync(leader, follower, 100));
+        leader.upsert("c", 1, [](size_t value) { return value; }) = 8;
+        CHECK(sync(leader, follower, 100));
+        CHECK(follower.get("b") == 6);
+        CHECK(follower.get("c") == 8);
+        CHECK(sameContents(leader, follower));
+    }
+}
+
+TEST(ChangeFeed, InsertLogsOneChange) {
+    for (size_t bufferSize : {size_t(0), size_t(8)}) {
+        AVLTree tree;
+        tree.setWriteBuffer(bufferSize, std::chrono::milliseconds(0));
+        tree.setChangeFeed(100);
+        uint64_t start = tree.changeSequence();
+        CHECK(tree.insert("a", 1));
+        tree.flushWriteBuffer();
+        CHECK(tree.changeSequence() == start + 1);
+        //an insert that finds the key writes nothing and logs nothing
+        CHECK(!tree.insert("a", 5));
+        CHECK(tree.changeSequence() == start + 1);
+
+        //an expired key written again is a single insert too
+        CHECK(tree.insert("b", 2, std::chrono::milliseconds(100)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        CHECK(tree.insert("b", 3));
+        CHECK(tree.changeSequence() == start + 3);
+
+        std::vector<AVLTree::ChangeEvent> events;
+        CHECK(tree.readChanges(start, 100, events));
+        CHECK(events.size() == 3);
+        for (const AVLTree::ChangeEvent& event : events) {
+            CHECK(event.op == AVLTree::ChangeOp::Insert);
+        }
+    }
+}
+
+TEST(ChangeFeed, FollowersConverge) {
+    for (bool coalesce : {false, true}) {
+        std::mt19937 rng(42);
+        AVLTree leader;
+        leader.setChangeFeed(64, coalesce);
+        AVLTree follower(leader);
+        size_t copies = 0;
+        for (int round = 0; round < 300; round++) {
+            //some rounds write more than the log holds
+            int writes = rng() % 4 == 0 ? 200 : 20;
+            for (int i = 0; i < writes; i++) {
+                std::string key = "k" + std::to_string(rng() % keySpace);
+                switch (rng() % 8) {
+                    case 0:
+                        leader.insert(key, rng() % 1000);
+                        break;
+                    case 1:
+                    case 2:
+                        leader.remove(key);
+                        break;
+                    case 3:
+                        leader[key] = rng() % 1000;
+                        break;
+                    case 4:
+                        leader[key]++;
+                        break;
+                    case 5:
+                        leader.try_emplace(key, 1).first += 3;
+                        break;
+                    case 6:
+                        leader.insert_or_assign(key, rng() % 1000);
+                        break;
+                    case 7:
+                        if (rng() % 50 == 0) {
+                            leader.clear();
+                        }
+                        else {
+                            leader.upsert(key, 1, [](size_t value) { return value * 2; });
+                        }
+                        break;
+                }
+            }
+            if (!sync(leader, follower, 1 + rng() % 32)) {
+                copies++;
+            }
+            CHECK(follower.appliedChangeSequence() == leader.changeSequence());
+            CHECK(sameContents(leader, follower));
+        }
+        CHECK(copies > 0);
+        CHECK(follower.checkInvariants());
+    }
+}
+
+TEST(ChangeFeed, RestartDropsOldFollowers) {
+    AVLTree leader;
+    leader.setChangeFeed(100);
+    AVLTree follower(leader);
+    leader.insert("a", 1);
+    CHECK(sync(leader, follower, 100));
+
+    //writes while the feed is off are never logged, so the follower must not resume after a restart
+    leader.setChangeFeed(0);
+    leader.insert("b", 2);
+    leader.setChangeFeed(100);
+    std::vector<AVLTree::ChangeEvent> events;
+    CHECK(!leader.readChanges(follower.appliedChangeSequence(), 100, events));
+    CHECK(!sync(leader, follower, 100));
+    CHECK(sameContents(leader, follower));
+
+    //a copy made after the restart resumes
+    leader.insert("c", 3);
+    CHECK(sync(leader, follower, 100));
+    CHECK(follower.get("c") == 3);
+
+    //switching to a coalesced feed starts a new log as well
+    leader.setChangeFeed(100, true);
+    CHECK(!leader.readChanges(follower.appliedChangeSequence(), 100, events));
+}
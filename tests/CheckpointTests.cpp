@@ -0,0 +1,225 @@
+/**
+ * CheckpointTests.cpp
+ */
+
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+static const size_t keySpace = 600;
+
+// true if both trees hold the same value (or nothing) for every key the tests use
+static bool sameContents(const AVLTree& a, const AVLTree& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < keySpace; i++) {
+        std::string key = "k" + std::to_string(i);
+        if (a.get(key) != b.get(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a round of mixed writes, including ones through returned references
+static void randomWrites(AVLTree& tree, std::mt19937& rng) {
+    for (int i = 0; i < 200; i++) {
+        std::string key = "k" + std::to_string(rng() % keySpace);
+        switch (rng() % 6) {
+            case 0:
+            case 1:
+                tree.insert(key, rng() % 1000);
+                break;
+            case 2:
+                tree.remove(key);
+                break;
+            case 3:
+                tree[key] = rng() % 1000;
+                break;
+            case 4:
+                tree.update(key, [](size_t value) { return value + 1; });
+                break;
+            default:
+                tree.upsert(key, 5, [](size_t value) { return value * 2; });
+        }
+    }
+}
+
+TEST(Checkpoint, DeltasKeepFollowerInSync) {
+    std::mt19937 rng(35);
+    AVLTree leader;
+    AVLTree follower;
+    std::stringstream snapshot;
+    CHECK(leader.writeCheckpoint(snapshot));
+    CHECK(follower.applyCheckpoint(snapshot));
+    for (int round = 0; round < 30; round++) {
+        randomWrites(leader, rng);
+        if (round == 20) {
+            leader.clear();
+            leader.insert("k1", 1);
+        }
+        std::stringstream delta;
+        CHECK(leader.writeCheckpoint(delta));
+        CHECK(follower.applyCheckpoint(delta));
+        CHECK(leader.checkInvariants());
+        CHECK(follower.checkInvariants());
+        CHECK(sameContents(leader, follower));
+
+        //nothing changed since, so the next delta is empty
+        std::stringstream empty;
+        CHECK(leader.writeCheckpoint(empty));
+        CHECK(empty.str().size() < 20);
+        CHECK(follower.applyCheckpoint(empty));
+    }
+}
+
+TEST(Checkpoint, DeltaIsSmallerThanSnapshot) {
+    AVLTree tree;
+    for (size_t i = 0; i < keySpace; i++) {
+        tree.insert("k" + std::to_string(i), i);
+    }
+    std::stringstream snapshot;
+    CHECK(tree.writeSnapshot(snapshot));
+    tree.insert_or_assign("k7", 70);
+    tree.remove("k8");
+    std::stringstream delta;
+    CHECK(tree.writeCheckpoint(delta));
+    CHECK(delta.str().size() * 20 < snapshot.str().size());
+}
+
+TEST(Checkpoint, FailedInsertIsNotInTheDelta) {
+    AVLTree tree;
+    for (size_t i = 0; i < keySpace; i++) {
+        tree.insert("k" + std::to_string(i), i);
+    }
+    std::stringstream snapshot;
+    CHECK(tree.writeSnapshot(snapshot));
+    std::stringstream empty;
+    CHECK(tree.writeCheckpoint(empty));
+    CHECK(!tree.insert("k7", 70));
+    CHECK(!tree.insert("k8", 80, std::chrono::hours(1)));
+    std::stringstream delta;
+    CHECK(tree.writeCheckpoint(delta));
+    CHECK(delta.str().size() == empty.str().size());
+
+    //try_emplace hands out a reference so its key is written either way
+    tree.try_emplace("k9", 90);
+    std::stringstream written;
+    CHECK(tree.writeCheckpoint(written));
+    CHECK(written.str().size() > empty.str().size());
+}
+
+TEST(Checkpoint, CutShortLeavesTreeUnchanged) {
+    AVLTree leader;
+    AVLTree follower;
+    for (size_t i = 0; i < 100; i++) {
+        leader.insert("k" + std::to_string(i), i);
+    }
+    std::stringstream snapshot;
+    CHECK(leader.writeSnapshot(snapshot));
+    CHECK(follower.applyCheckpoint(snapshot));
+
+    leader.remove("k1");
+    leader.insert_or_assign("k2", 20);
+    leader.insert("k200", 200);
+    std::stringstream delta;
+    CHECK(leader.writeCheckpoint(delta));
+    std::string bytes = delta.str();
+    for (size_t cut = 1; cut < bytes.size(); cut++) {
+        std::stringstream truncated(bytes.substr(0, cut));
+        CHECK(!follower.applyCheckpoint(truncated));
+        CHECK(follower.get("k1") == 1 and follower.get("k2") == 2 and !follower.contains("k200"));
+    }
+    //still in step with the leader, so the whole delta applies
+    std::stringstream whole(bytes);
+    CHECK(follower.applyCheckpoint(whole));
+    CHECK(!follower.contains("k1") and follower.get("k2") == 20 and follower.get("k200") == 200);
+
+    //a cut off snapshot does not clear the tree either
+    std::stringstream fullSnapshot;
+    CHECK(leader.writeSnapshot(fullSnapshot));
+    std::string snapshotBytes = fullSnapshot.str();
+    std::stringstream truncated(snapshotBytes.substr(0, snapshotBytes.size() - 1));
+    CHECK(!follower.applyCheckpoint(truncated));
+    CHECK(follower.size() == 100 and follower.get("k200") == 200);
+    CHECK(follower.checkInvariants());
+}
+
+TEST(Checkpoint, RejectsDeltasOutOfOrder) {
+    AVLTree leader;
+    AVLTree follower;
+    std::vector<std::string> checkpoints;
+    for (size_t i = 0; i < 3; i++) {
+        leader.insert("k" + std::to_string(i), i);
+        std::stringstream checkpoint;
+        CHECK(leader.writeCheckpoint(checkpoint));
+        checkpoints.push_back(checkpoint.str());
+    }
+    std::stringstream second(checkpoints[1]);
+    CHECK(!follower.applyCheckpoint(second));
+    std::stringstream first(checkpoints[0]);
+    CHECK(follower.applyCheckpoint(first));
+    std::stringstream third(checkpoints[2]);
+    CHECK(!follower.applyCheckpoint(third));
+    std::stringstream notCheckpoint("not a checkpoint");
+    CHECK(!follower.applyCheckpoint(notCheckpoint));
+    CHECK(follower.size() == 1);
+}
+
+TEST(Checkpoint, CompactedChainMatchesReplay) {
+    std::mt19937 rng(3500);
+    AVLTree leader;
+    std::vector<std::string> checkpoints;
+    for (int round = 0; round < 10; round++) {
+        randomWrites(leader, rng);
+        std::stringstream checkpoint;
+        CHECK(leader.writeCheckpoint(checkpoint));
+        checkpoints.push_back(checkpoint.str());
+    }
+
+    //the whole chain from the first snapshot
+    std::vector<std::stringstream> streams;
+    for (const std::string& checkpoint : checkpoints) {
+        streams.emplace_back(checkpoint);
+    }
+    std::vector<std::istream*> inputs;
+    for (std::stringstream& stream : streams) {
+        inputs.push_back(&stream);
+    }
+    std::stringstream compacted;
+    CHECK(AVLTree::compactCheckpoints(inputs, compacted));
+    AVLTree restored;
+    CHECK(restored.applyCheckpoint(compacted));
+    CHECK(sameContents(restored, leader));
+
+    //deltas 2 to 9 as one delta on top of the first two checkpoints
+    AVLTree base;
+    for (size_t i = 0; i < 2; i++) {
+        std::stringstream checkpoint(checkpoints[i]);
+        CHECK(base.applyCheckpoint(checkpoint));
+    }
+    std::vector<std::stringstream> deltaStreams;
+    for (size_t i = 2; i < checkpoints.size(); i++) {
+        deltaStreams.emplace_back(checkpoints[i]);
+    }
+    std::vector<std::istream*> deltas;
+    for (std::stringstream& stream : deltaStreams) {
+        deltas.push_back(&stream);
+    }
+    std::stringstream mergedDelta;
+    CHECK(AVLTree::compactCheckpoints(deltas, mergedDelta));
+    CHECK(base.applyCheckpoint(mergedDelta));
+    CHECK(sameContents(base, leader));
+
+    //a gap in the chain
+    std::stringstream first(checkpoints[2]);
+    std::stringstream later(checkpoints[4]);
+    std::istream* gap[] = {&first, &later};
+    std::stringstream out;
+    CHECK(!AVLTree::compactCheckpoints(gap, out));
+}
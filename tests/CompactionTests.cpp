@@ -0,0 +1,143 @@
+/**
+ * CompactionTests.cpp
+ */
+
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+// true if tree holds exactly the entries of model
+static bool matches(const AVLTree& tree, const std::map<std::string, size_t>& model) {
+    if (tree.size() != model.size()) {
+        return false;
+    }
+    for (const auto& [key, value] : model) {
+        std::optional<size_t> found = tree.get(key);
+        if (!found or *found != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(Compaction, CompactKeepsContents) {
+    for (AVLTree::BalancePolicy policy : {AVLTree::BalancePolicy::AVL, AVLTree::BalancePolicy::WAVL}) {
+        std::mt19937 rng(11);
+        AVLTree tree(policy);
+        tree.setAggregate(AVLTree::Aggregate::sum());
+        std::map<std::string, size_t> model;
+        for (int i = 0; i < 5000; i++) {
+            std::string key = std::to_string(rng() % 3000);
+            tree.insert(key, i);
+            model.emplace(key, i);
+        }
+        tree.compact();
+        CHECK(tree.checkInvariants());
+        CHECK(matches(tree, model));
+
+        //writes after a compaction mix block nodes with fresh ones
+        for (int i = 0; i < 5000; i++) {
+            std::string key = std::to_string(rng() % 3000);
+            if (rng() % 2) {
+                tree.insert(key, i);
+                model.emplace(key, i);
+            } else {
+                tree.remove(key);
+                model.erase(key);
+            }
+        }
+        CHECK(tree.checkInvariants());
+        CHECK(matches(tree, model));
+
+        tree.compact();
+        CHECK(matches(tree, model));
+        AVLTree copy(tree);
+        CHECK(copy.checkInvariants());
+        CHECK(matches(copy, model));
+    }
+}
+
+TEST(Compaction, ReferencesAfterCompact) {
+    AVLTree tree;
+    for (size_t i = 0; i < 100; i++) {
+        tree.insert(std::to_string(i), i);
+    }
+    tree.compact();
+    //references taken after the compaction write into the moved nodes
+    tree["42"] = 4200;
+    size_t& value = tree["7"];
+    value = 700;
+    CHECK(tree.get("42") == 4200);
+    CHECK(tree.get("7") == 700);
+    CHECK(tree.checkInvariants());
+}
+
+TEST(Compaction, EmptyAndClearedTrees) {
+    AVLTree tree;
+    tree.compact();
+    CHECK(tree.size() == 0);
+    for (size_t i = 0; i < 1000; i++) {
+        tree.insert(std::to_string(i), i);
+    }
+    tree.compact();
+    tree.clear();
+    CHECK(tree.size() == 0);
+    CHECK(tree.checkInvariants());
+    tree.insert("a", 1);
+    tree.compact();
+    CHECK(tree.get("a") == 1);
+}
+
+TEST(Compaction, StepsInterleavedWithWrites) {
+    std::mt19937 rng(5);
+    AVLTree tree;
+    std::map<std::string, size_t> model;
+    for (int i = 0; i < 4000; i++) {
+        std::string key = std::to_string(rng() % 4000);
+        tree.insert(key, i);
+        model.emplace(key, i);
+    }
+
+    CHECK(!tree.compactionPending());
+    CHECK(tree.compactStep(10));
+    tree.startCompaction();
+    CHECK(tree.compactionPending());
+    size_t steps = 0;
+    while (!tree.compactStep(64)) {
+        steps++;
+        //removals make the next step plan again, inserts stay where they are
+        for (int i = 0; i < 20; i++) {
+            std::string key = std::to_string(rng() % 4000);
+            if (rng() % 2) {
+                tree.insert(key, i);
+                model.emplace(key, i);
+            } else {
+                tree.remove(key);
+                model.erase(key);
+            }
+        }
+        CHECK(tree.checkInvariants());
+        CHECK(steps < 1000);
+    }
+    CHECK(steps > 0);
+    CHECK(!tree.compactionPending());
+    CHECK(matches(tree, model));
+
+    //compact() finishes a compaction that is still running
+    tree.startCompaction();
+    tree.compactStep(100);
+    tree.compact();
+    CHECK(!tree.compactionPending());
+    CHECK(tree.checkInvariants());
+    CHECK(matches(tree, model));
+
+    //a tree destroyed midway through a compaction
+    AVLTree partial(tree);
+    partial.startCompaction();
+    partial.compactStep(500);
+    CHECK(partial.compactionPending());
+    CHECK(matches(partial, model));
+}
@@ -0,0 +1,116 @@
+/**
+ * DiskAVLTreeTests.cpp
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "DiskAVLTree.h"
+
+// page file in the temp directory, removed when the test is done with it
+struct TempPageFile {
+    std::string path;
+
+    explicit TempPageFile(const std::string& name) {
+        this->path = (std::filesystem::temp_directory_path() / ("AVLTreeTests-" + name + ".pages")).string();
+        std::remove(this->path.c_str());
+    }
+    ~TempPageFile() {
+        std::remove(this->path.c_str());
+    }
+};
+
+TEST(DiskAVLTree, MatchesModelAndReopens) {
+    //smallest cache, a few pages and every page cached
+    for (size_t budget : {size_t(0), size_t(64 * 1024), size_t(8 << 20)}) {
+        TempPageFile file("model" + std::to_string(budget));
+        std::map<std::string, size_t> model;
+        std::mt19937 rng(36);
+        {
+            DiskAVLTree tree(file.path, budget, 24);
+            CHECK(tree.good());
+            for (int i = 0; i < 20000; i++) {
+                std::string key = "k" + std::to_string(rng() % 4000);
+                switch (rng() % 5) {
+                    case 0:
+                    case 1: {
+                        size_t value = rng() % 100;
+                        CHECK(tree.insert(key, value) == (model.count(key) == 0));
+                        model.emplace(key, value);
+                        break;
+                    }
+                    case 2:
+                        CHECK(tree.remove(key) == (model.erase(key) == 1));
+                        break;
+                    case 3:
+                        tree[key] += 3;
+                        model[key] += 3;
+                        break;
+                    default: {
+                        auto it = model.find(key);
+                        CHECK(tree.get(key) == (it == model.end() ? std::nullopt : std::optional<size_t>(it->second)));
+                    }
+                }
+            }
+            CHECK(tree.good());
+            CHECK(tree.size() == model.size());
+            CHECK(tree.getHeight() <= 1.45 * std::log2(model.size() + 2));
+
+            std::vector<std::string> values;
+            std::vector<std::string> range;
+            for (const auto& [key, value] : model) {
+                values.push_back(std::to_string(value));
+                if (key >= "k2" and key <= "k3") {
+                    range.push_back(std::to_string(value));
+                }
+            }
+            CHECK(tree.keys() == values);
+            CHECK(tree.findRange("k2", "k3") == range);
+            CHECK(tree.flush());
+        }
+
+        DiskAVLTree reopened(file.path, budget);
+        CHECK(reopened.good());
+        CHECK(reopened.size() == model.size());
+        bool allFound = true;
+        for (const auto& [key, value] : model) {
+            allFound = allFound and reopened.get(key) == value;
+        }
+        CHECK(allFound);
+    }
+}
+
+TEST(DiskAVLTree, LongKeys) {
+    TempPageFile file("long");
+    DiskAVLTree tree(file.path, 0, 8);
+    CHECK(!tree.insert("123456789", 1));
+    bool threw = false;
+    try {
+        tree["123456789"] = 1;
+    }
+    catch (const std::length_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(tree.size() == 0);
+    tree["12345678"] = 5;
+    CHECK(tree.get("12345678") == 5);
+    CHECK(tree.size() == 1);
+}
+
+TEST(DiskAVLTree, RejectsOtherFiles) {
+    TempPageFile file("garbage");
+    {
+        std::ofstream garbage(file.path, std::ios::binary);
+        garbage << "not a page file at all";
+    }
+    DiskAVLTree tree(file.path, 0);
+    CHECK(!tree.good());
+}
@@ -0,0 +1,122 @@
+/**
+ * EvictionTests.cpp
+ */
+
+#include <random>
+#include <string>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+TEST(Eviction, StaysWithinCapacityUnderRandomOps) {
+    for (AVLTree::EvictionPolicy policy : {AVLTree::EvictionPolicy::LeastRecentlyUsed, AVLTree::EvictionPolicy::Clock,
+                                           AVLTree::EvictionPolicy::SmallestKey, AVLTree::EvictionPolicy::LargestKey}) {
+        std::mt19937 rng(29);
+        AVLTree tree;
+        tree.setCapacity(100, 0, policy);
+        for (int i = 0; i < 20000; i++) {
+            std::string key = std::to_string(rng() % 1000);
+            switch (rng() % 4) {
+                case 0:
+                    tree.remove(key);
+                    break;
+                case 1:
+                    tree.get(key);
+                    break;
+                default:
+                    tree.insert(key, i);
+            }
+            CHECK(tree.size() <= 100);
+            if (i % 1000 == 0) {
+                CHECK(tree.checkInvariants());
+            }
+        }
+        CHECK(tree.checkInvariants());
+    }
+}
+
+TEST(Eviction, LeastRecentlyUsedKeepsReadKeys) {
+    AVLTree tree;
+    tree.setCapacity(3, 0, AVLTree::EvictionPolicy::LeastRecentlyUsed);
+    tree.insert("a", 1);
+    tree.insert("b", 2);
+    tree.insert("c", 3);
+    tree.get("a");
+    tree.insert("d", 4);
+    CHECK(tree.size() == 3);
+    CHECK(tree.contains("a"));
+    CHECK(!tree.contains("b"));
+}
+
+TEST(Eviction, FailedInsertLeavesRecencyAlone) {
+    for (size_t bufferSize : {size_t(0), size_t(8)}) {
+        AVLTree tree;
+        tree.setCapacity(3, 0, AVLTree::EvictionPolicy::LeastRecentlyUsed);
+        tree.setWriteBuffer(bufferSize, std::chrono::milliseconds(0));
+        tree.insert("a", 1);
+        tree.insert("b", 2);
+        tree.insert("c", 3);
+        tree.flushWriteBuffer();
+        CHECK(!tree.insert("a", 9));
+        tree.insert("d", 4);
+        tree.flushWriteBuffer();
+        CHECK(tree.size() == 3);
+        CHECK(!tree.contains("a"));
+        CHECK(tree.contains("b"));
+    }
+}
+
+TEST(Eviction, ClockGivesNewKeysAFullSweep) {
+    AVLTree tree;
+    tree.setCapacity(4, 0, AVLTree::EvictionPolicy::Clock);
+    tree.insert("a", 1);
+    tree.insert("b", 2);
+    tree.insert("c", 3);
+    tree.insert("d", 4);
+    tree.get("a");
+    tree.get("b");
+    //a and b get a second chance, c goes and the hand stops in the middle of the list
+    tree.insert("e", 5);
+    tree.insert("f", 6);
+    tree.insert("g", 7);
+    //f was inserted behind the hand so the untouched a goes before it
+    tree.insert("h", 8);
+    CHECK(tree.checkInvariants());
+    CHECK(tree.size() == 4);
+    CHECK(!tree.contains("a"));
+    CHECK(tree.contains("f"));
+    CHECK(tree.contains("h"));
+}
+
+TEST(Eviction, KeyOrderPolicies) {
+    AVLTree smallest;
+    smallest.setCapacity(3, 0, AVLTree::EvictionPolicy::SmallestKey);
+    for (const char* key : {"e", "d", "c", "b", "a"}) {
+        smallest.insert(key, 1);
+    }
+    //the key just inserted is never the one evicted
+    CHECK(smallest.size() == 3);
+    CHECK(smallest.contains("a") and smallest.contains("d") and smallest.contains("e"));
+
+    AVLTree largest;
+    largest.setCapacity(3, 0, AVLTree::EvictionPolicy::LargestKey);
+    for (const char* key : {"a", "b", "c", "d", "e"}) {
+        largest.insert(key, 1);
+    }
+    CHECK(largest.size() == 3);
+    CHECK(largest.contains("a") and largest.contains("b") and largest.contains("e"));
+}
+
+TEST(Eviction, ByteLimitAndCopies) {
+    AVLTree tree;
+    tree.setCapacity(0, 1000, AVLTree::EvictionPolicy::Clock);
+    for (size_t i = 0; i < 100; i++) {
+        tree.insert(std::to_string(i), i);
+        CHECK(tree.bytes() <= 1000);
+    }
+    CHECK(tree.checkInvariants());
+    AVLTree copy(tree);
+    CHECK(copy.checkInvariants());
+    copy.insert("x", 1);
+    CHECK(copy.bytes() <= 1000);
+    CHECK(copy.checkInvariants());
+}
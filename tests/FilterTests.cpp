@@ -0,0 +1,129 @@
+/**
+ * FilterTests.cpp
+ */
+
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+#include "CountingBloomFilter.h"
+
+TEST(Filter, NoFalseNegatives) {
+    CountingBloomFilter filter(10000, 0.01);
+    for (size_t i = 0; i < 10000; i++) {
+        filter.add("key" + std::to_string(i));
+    }
+    CHECK(filter.keys() == 10000);
+    for (size_t i = 0; i < 10000; i++) {
+        CHECK(filter.mayContain("key" + std::to_string(i)));
+    }
+    //false positives near the target rate
+    size_t falsePositives = 0;
+    for (size_t i = 0; i < 100000; i++) {
+        if (filter.mayContain("absent" + std::to_string(i))) {
+            falsePositives++;
+        }
+    }
+    CHECK(falsePositives < 3000);
+    CHECK(filter.expectedFalsePositiveRate() < 0.03);
+}
+
+TEST(Filter, RemoveAndClear) {
+    CountingBloomFilter filter(1000, 0.01);
+    for (size_t i = 0; i < 1000; i++) {
+        filter.add("key" + std::to_string(i));
+    }
+    //removing half must not hide the other half
+    for (size_t i = 0; i < 1000; i += 2) {
+        filter.remove("key" + std::to_string(i));
+    }
+    CHECK(filter.keys() == 500);
+    size_t stillMaybe = 0;
+    for (size_t i = 0; i < 1000; i++) {
+        bool maybe = filter.mayContain("key" + std::to_string(i));
+        if (i % 2 == 1) {
+            CHECK(maybe);
+        } else if (maybe) {
+            stillMaybe++;
+        }
+    }
+    CHECK(stillMaybe < 50);
+
+    //a key added many times saturates its counters but is never lost
+    for (int i = 0; i < 40; i++) {
+        filter.add("hot");
+    }
+    filter.remove("hot");
+    CHECK(filter.mayContain("hot"));
+
+    filter.clear();
+    CHECK(filter.keys() == 0);
+    CHECK(!filter.mayContain("key1"));
+}
+
+TEST(Filter, TreeLookupsWithFilter) {
+    AVLTree tree;
+    tree.setFilter(100, 0.01);
+    for (size_t i = 0; i < 1000; i++) {
+        tree.insert("key" + std::to_string(i), i);
+    }
+    //the filter was rebuilt larger as the tree grew past it
+    AVLTree::FilterStats stats = tree.filterStats();
+    CHECK(stats.capacity >= 1000);
+    CHECK(stats.bytes > 0);
+
+    for (size_t i = 0; i < 1000; i += 3) {
+        tree.remove("key" + std::to_string(i));
+    }
+    for (size_t i = 0; i < 1000; i++) {
+        std::string key = "key" + std::to_string(i);
+        CHECK(tree.contains(key) == (i % 3 != 0));
+        CHECK(tree.get(key) == (i % 3 != 0 ? std::optional<size_t>(i) : std::nullopt));
+    }
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 2000; i++) {
+        keys.push_back("key" + std::to_string((i * 7919) % 2000));
+    }
+    std::vector<std::optional<size_t>> out(keys.size());
+    tree.getMany(keys, out);
+    for (size_t i = 0; i < keys.size(); i++) {
+        CHECK(out[i] == tree.get(keys[i]));
+    }
+
+    stats = tree.filterStats();
+    CHECK(stats.rejected > 0);
+    CHECK(stats.observedFalsePositiveRate < 0.1);
+
+    //copies keep the filter but start their own counts
+    AVLTree copy(tree);
+    CHECK(copy.filterStats().capacity == stats.capacity);
+    CHECK(copy.filterStats().rejected == 0);
+    CHECK(copy.contains("key1") and !copy.contains("key0"));
+
+    tree.setFilter(0);
+    CHECK(tree.filterStats().bytes == 0);
+    CHECK(tree.contains("key1") and !tree.contains("key0"));
+}
+
+TEST(Filter, ConcurrentReadersCountEveryLookup) {
+    AVLTree tree;
+    tree.setFilter(1000, 0.01);
+    for (size_t i = 0; i < 1000; i++) {
+        tree.insert("key" + std::to_string(i), i);
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 8; t++) {
+        threads.emplace_back([&tree, t] {
+            for (size_t i = 0; i < 5000; i++) {
+                tree.contains("absent" + std::to_string(t * 5000 + i));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    AVLTree::FilterStats stats = tree.filterStats();
+    CHECK(stats.rejected + stats.falsePositives == 40000);
+}
@@ -0,0 +1,62 @@
+/**
+ * GetManyTests.cpp
+ */
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+// true if out[i] holds the value model has for keys[i] or nothing when model lacks it
+static bool matchesModel(const std::map<std::string, size_t>& model, const std::vector<std::string>& keys,
+                         const std::vector<std::optional<size_t>>& out) {
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto it = model.find(keys[i]);
+        std::optional<size_t> expected = (it == model.end()) ? std::nullopt : std::optional<size_t>(it->second);
+        if (out[i] != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(GetMany, UnsortedAndSortedBatches) {
+    std::mt19937 rng(28);
+    AVLTree tree;
+    std::map<std::string, size_t> model;
+    for (int i = 0; i < 50000; i++) {
+        std::string key = "key" + std::to_string(rng() % 100000);
+        size_t value = rng();
+        if (tree.insert(key, value)) {
+            model[key] = value;
+        }
+    }
+    //sizes around the group size, including a partial last group and duplicate keys
+    for (size_t batch : {0, 1, 15, 16, 17, 100, 513}) {
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < batch; i++) {
+            keys.push_back("key" + std::to_string(rng() % 100000));
+        }
+        if (batch > 1) {
+            keys.push_back(keys.front());
+        }
+        std::vector<std::optional<size_t>> out(keys.size());
+        tree.getMany(keys, out);
+        CHECK(matchesModel(model, keys, out));
+        std::sort(keys.begin(), keys.end());
+        tree.getMany(keys, out);
+        CHECK(matchesModel(model, keys, out));
+    }
+}
+
+TEST(GetMany, EmptyTree) {
+    AVLTree tree;
+    std::vector<std::string> keys = {"a", "b", "c"};
+    std::vector<std::optional<size_t>> out(keys.size(), 1);
+    tree.getMany(keys, out);
+    CHECK(!out[0] and !out[1] and !out[2]);
+}
@@ -0,0 +1,156 @@
+/**
+ * ImportTests.cpp
+ */
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLImport.h"
+#include "AVLTree.h"
+
+// dump file in the temp directory, removed when the test is done with it
+struct TempDumpFile {
+    std::string path;
+
+    TempDumpFile(const std::string& name, const std::string& contents) {
+        this->path = (std::filesystem::temp_directory_path() / ("AVLTreeTests-" + name)).string();
+        std::ofstream out(this->path, std::ios::binary);
+        out << contents;
+    }
+    ~TempDumpFile() {
+        std::remove(this->path.c_str());
+    }
+};
+
+TEST(Import, AssignSortedBuildsBalancedTrees) {
+    for (AVLTree::BalancePolicy policy : {AVLTree::BalancePolicy::AVL, AVLTree::BalancePolicy::WAVL}) {
+        for (size_t count : {size_t(0), size_t(1), size_t(2), size_t(7), size_t(1000)}) {
+            std::vector<std::string> keys;
+            for (size_t i = 0; i < count; i++) {
+                keys.push_back("k" + std::to_string(100000 + i));
+            }
+            std::vector<std::pair<std::string_view, size_t>> entries;
+            for (size_t i = 0; i < count; i++) {
+                entries.emplace_back(keys[i], i);
+            }
+            AVLTree tree(policy);
+            tree.setAggregate(AVLTree::Aggregate::sum());
+            tree.insert("old", 1);
+            CHECK(tree.assignSorted(entries));
+            CHECK(tree.checkInvariants());
+            CHECK(tree.size() == count);
+            CHECK(!tree.contains("old"));
+            for (size_t i = 0; i < count; i++) {
+                CHECK(tree.get(keys[i]) == i);
+            }
+            CHECK(tree.aggregateRange("", "~") == count * (count - (count > 0 ? 1 : 0)) / 2);
+            //inserts after the build rebalance as usual
+            tree.insert("a", 1);
+            tree.insert("z", 1);
+            CHECK(tree.checkInvariants());
+        }
+    }
+}
+
+TEST(Import, AssignSortedRejectsUnsorted) {
+    AVLTree tree;
+    tree.insert("keep", 5);
+    std::vector<std::pair<std::string_view, size_t>> unsorted = {{"b", 1}, {"a", 2}};
+    std::vector<std::pair<std::string_view, size_t>> repeated = {{"a", 1}, {"a", 2}};
+    CHECK(!tree.assignSorted(unsorted));
+    CHECK(!tree.assignSorted(repeated));
+    CHECK(tree.size() == 1);
+    CHECK(tree.get("keep") == 5);
+}
+
+TEST(Import, AssignSortedRecencyMatchesCopy) {
+    for (AVLTree::EvictionPolicy policy : {AVLTree::EvictionPolicy::LeastRecentlyUsed, AVLTree::EvictionPolicy::Clock}) {
+        std::vector<std::string> keys;
+        std::vector<std::pair<std::string_view, size_t>> entries;
+        for (size_t i = 0; i < 100; i++) {
+            keys.push_back("k" + std::to_string(100 + i));
+        }
+        for (size_t i = 0; i < 100; i++) {
+            entries.emplace_back(keys[i], i);
+        }
+        AVLTree built;
+        built.setCapacity(100, 0, policy);
+        CHECK(built.assignSorted(entries));
+        AVLTree copy(built);
+
+        //the same keys are evicted first from both
+        for (size_t i = 0; i < 10; i++) {
+            built.insert("new" + std::to_string(i), i);
+            copy.insert("new" + std::to_string(i), i);
+        }
+        CHECK(built.checkInvariants());
+        for (const std::string& key : keys) {
+            CHECK(built.contains(key) == copy.contains(key));
+        }
+    }
+}
+
+TEST(Import, ImportFileMatchesModel) {
+    std::mt19937 rng(40);
+    std::map<std::string, size_t> model;
+    std::string contents;
+    for (int i = 0; i < 20000; i++) {
+        std::string key = "key" + std::to_string(rng() % 5000);
+        size_t value = rng() % 100000;
+        contents += key + "," + std::to_string(value) + (i % 3 == 0 ? "\r\n" : "\n");
+        model[key] = value;
+    }
+    contents += "\nnodelimiter\n,5\nkey1,notanumber\n";
+    TempDumpFile file("import.csv", contents);
+
+    //one thread and one block, then many threads over small blocks
+    for (size_t threads : {size_t(1), size_t(4)}) {
+        for (size_t blockBytes : {size_t(64) << 20, size_t(4096)}) {
+            AVLTree tree;
+            tree.insert("stale", 1);
+            ImportOptions options;
+            options.threads = threads;
+            options.blockBytes = blockBytes;
+            size_t callbacks = 0;
+            options.onProgress = [&callbacks](const ImportProgress&) {
+                callbacks++;
+            };
+            ImportProgress progress;
+            CHECK(importFile(file.path, tree, options, &progress));
+            CHECK(tree.checkInvariants());
+            CHECK(tree.size() == model.size());
+            CHECK(!tree.contains("stale"));
+            for (const auto& [key, value] : model) {
+                CHECK(tree.get(key) == value);
+            }
+            CHECK(progress.stage == ImportProgress::Stage::Done);
+            CHECK(progress.records == 20000);
+            CHECK(progress.malformedLines == 3);
+            CHECK(progress.keys == model.size());
+            CHECK(progress.bytesRead == contents.size());
+            CHECK(callbacks > 0);
+        }
+    }
+}
+
+TEST(Import, WhitespaceDelimitedAndMissingFiles) {
+    TempDumpFile file("import.txt", "first key\t1\nsecond  2\nfirst key 3\n");
+    AVLTree tree;
+    CHECK(importFile(file.path, tree));
+    //the value comes after the last separator so keys keep their spaces
+    CHECK(tree.size() == 2);
+    CHECK(tree.get("first key") == 3);
+    CHECK(tree.get("second") == 2);
+
+    AVLTree untouched;
+    untouched.insert("a", 1);
+    CHECK(!importFile(file.path + ".missing", untouched));
+    CHECK(untouched.get("a") == 1);
+}
@@ -0,0 +1,94 @@
+/**
+ * LatencyHistogramTests.cpp
+ */
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+#include "LatencyHistogram.h"
+
+TEST(LatencyHistogram, BucketsCoverEveryValueOnce) {
+    //each bucket starts right after the one before it ends
+    for (size_t bucket = 1; bucket < LatencyHistogram::bucketCount; bucket++) {
+        uint64_t low = LatencyHistogram::bucketUpperBound(bucket - 1) + 1;
+        CHECK(LatencyHistogram::bucketFor(low) == bucket);
+        CHECK(LatencyHistogram::bucketFor(LatencyHistogram::bucketUpperBound(bucket)) == bucket);
+        CHECK(LatencyHistogram::bucketUpperBound(bucket) > LatencyHistogram::bucketUpperBound(bucket - 1));
+    }
+    //precision is 1/16 of the value
+    for (uint64_t value : {uint64_t(17), uint64_t(1000), uint64_t(123456789)}) {
+        size_t bucket = LatencyHistogram::bucketFor(value);
+        uint64_t low = LatencyHistogram::bucketUpperBound(bucket - 1) + 1;
+        CHECK(LatencyHistogram::bucketUpperBound(bucket) - low < value / 16 + 1);
+    }
+}
+
+TEST(LatencyHistogram, OverflowBucketHoldsOnlyTheLargest) {
+    const uint64_t largestFinite = (uint64_t(1) << LatencyHistogram::maxExponent) - 1;
+    size_t lastFinite = LatencyHistogram::bucketFor(largestFinite);
+    size_t overflow = LatencyHistogram::bucketFor(uint64_t(1) << LatencyHistogram::maxExponent);
+    CHECK(overflow == LatencyHistogram::bucketCount - 1);
+    CHECK(lastFinite == overflow - 1);
+    CHECK(LatencyHistogram::bucketUpperBound(lastFinite) == largestFinite);
+    CHECK(LatencyHistogram::bucketUpperBound(overflow) == UINT64_MAX);
+    CHECK(LatencyHistogram::bucketFor(UINT64_MAX) == overflow);
+}
+
+TEST(LatencyHistogram, PercentilesAndReset) {
+    LatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        histogram.record(i);
+    }
+    LatencySnapshot snapshot = histogram.snapshot();
+    CHECK(snapshot.count == 1000);
+    CHECK(snapshot.maxNanoseconds == 1000);
+    CHECK(snapshot.meanNanoseconds() == 500.5);
+    uint64_t p50 = snapshot.percentile(0.5);
+    CHECK(p50 >= 500 and p50 <= 500 + 500 / 16);
+    CHECK(snapshot.percentile(1.0) == 1000);
+
+    CHECK(histogram.snapshot(true).count == 1000);
+    CHECK(histogram.snapshot().count == 0);
+    CHECK(histogram.snapshot().percentile(0.5) == 0);
+}
+
+TEST(LatencyHistogram, ThreadsCountEveryCall) {
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 12; t++) {
+        threads.emplace_back([&histogram] {
+            for (uint64_t i = 0; i < 10000; i++) {
+                histogram.record(i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(histogram.snapshot().count == 120000);
+}
+
+TEST(LatencyHistogram, TreeSamplesItsCalls) {
+    AVLTree tree;
+    CHECK(tree.latencySnapshot(AVLTree::TimedOp::Insert).count == 0);
+    tree.setLatencySampling(1);
+    for (size_t i = 0; i < 100; i++) {
+        tree.insert(std::to_string(i), i);
+        tree.get(std::to_string(i));
+    }
+    CHECK(tree.latencySnapshot(AVLTree::TimedOp::Insert).count == 100);
+    CHECK(tree.latencySnapshot(AVLTree::TimedOp::Get, true).count == 100);
+    CHECK(tree.latencySnapshot(AVLTree::TimedOp::Get).count == 0);
+
+    tree.setLatencySampling(10);
+    for (size_t i = 0; i < 10000; i++) {
+        tree.get(std::to_string(i % 100));
+    }
+    //one in ten picked at random
+    uint64_t sampled = tree.latencySnapshot(AVLTree::TimedOp::Get).count;
+    CHECK(sampled > 700 and sampled < 1300);
+    tree.setLatencySampling(0);
+    CHECK(tree.latencySnapshot(AVLTree::TimedOp::Get).count == 0);
+}
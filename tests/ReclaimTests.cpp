@@ -0,0 +1,65 @@
+/**
+ * ReclaimTests.cpp
+ */
+
+#include <string>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+// destroyed after the background reclaimer has been stopped at exit, its nodes must still be freed safely
+static AVLTree exitTree;
+
+TEST(Reclaim, ClearIsIncremental) {
+    AVLTree tree;
+    for (size_t i = 0; i < 10000; i++) {
+        tree.insert(std::to_string(i), i);
+    }
+    tree.clear();
+    CHECK(tree.size() == 0);
+    CHECK(tree.bytes() == 0);
+    CHECK(tree.reclaimPending());
+    CHECK(!tree.contains("5"));
+
+    //the tree is usable while the old nodes are still waiting
+    for (size_t i = 0; i < 100; i++) {
+        tree.insert(std::to_string(i), i);
+    }
+    CHECK(tree.checkInvariants());
+    CHECK(tree.size() == 100);
+    CHECK(tree.reclaim(1000) == 1000);
+    tree.reclaim();
+    CHECK(!tree.reclaimPending());
+    CHECK(tree.get("42") == 42);
+}
+
+TEST(Reclaim, WritesFreeBatchesAlongTheWay) {
+    AVLTree tree;
+    for (size_t i = 0; i < 1000; i++) {
+        tree.insert(std::to_string(i), i);
+    }
+    tree.clear();
+    for (size_t i = 0; i < 100 and tree.reclaimPending(); i++) {
+        tree.insert("k" + std::to_string(i), i);
+    }
+    CHECK(!tree.reclaimPending());
+}
+
+TEST(Reclaim, BackgroundThread) {
+    AVLTree tree;
+    tree.setBackgroundReclaim(true);
+    for (size_t i = 0; i < 100000; i++) {
+        tree.insert(std::to_string(i), i);
+    }
+    tree.clear();
+    CHECK(!tree.reclaimPending());
+    tree.insert("x", 1);
+    AVLTree assigned;
+    assigned = tree;
+    CHECK(assigned.checkInvariants());
+    CHECK(assigned.get("x") == 1);
+
+    exitTree.setBackgroundReclaim(true);
+    for (size_t i = 0; i < 1000; i++) {
+        exitTree.insert(std::to_string(i), i);
+    }
+}
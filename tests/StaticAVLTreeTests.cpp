@@ -0,0 +1,55 @@
+/**
+ * StaticAVLTreeTests.cpp
+ */
+
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+#include "StaticAVLTree.h"
+
+// lookups run at compile time
+constexpr StaticAVLTree commands({{"remove", 4}, {"add", 1}, {"list", 3}, {"help", 2}, {"add", 9}});
+static_assert(commands.size() == 4);
+static_assert(commands.contains("help") and !commands.contains("quit"));
+static_assert(commands.get("add") == 1);
+static_assert(commands.getHeight() == 2);
+
+TEST(StaticAVLTree, MatchesAVLTree) {
+    const std::pair<std::string_view, size_t> entries[] = {
+        {"m", 1}, {"c", 2}, {"x", 3}, {"a", 4}, {"e", 5}, {"q", 6}, {"z", 7}, {"c", 8}, {"b", 9}, {"y", 10}};
+    StaticAVLTree staticTree(entries);
+    AVLTree tree;
+    for (const auto& [key, value] : entries) {
+        tree.insert(std::string(key), value);
+    }
+    CHECK(staticTree.size() == tree.size());
+    CHECK(staticTree.keys() == tree.keys());
+    CHECK(staticTree.findRange("b", "q") == tree.findRange("b", "q"));
+    CHECK(staticTree.findRange("d", "d").empty());
+    for (const auto& [key, value] : entries) {
+        CHECK(staticTree.get(key) == tree.get(std::string(key)));
+    }
+    CHECK(!staticTree.get("d"));
+}
+
+TEST(StaticAVLTree, BuiltAtCompileTimeFromManyRepeats) {
+    static constexpr auto build = [] {
+        //100 entries in a scrambled order holding 20 distinct one and two letter keys
+        std::pair<std::string_view, size_t> entries[100] = {};
+        constexpr std::string_view letters = "abcdefghijk";
+        for (size_t i = 0; i < 100; i++) {
+            size_t scrambled = i * 37 % 100;
+            entries[i] = {letters.substr(scrambled / 10, 1 + scrambled % 2), scrambled};
+        }
+        return StaticAVLTree(entries);
+    };
+    constexpr auto tree = build();
+    static_assert(tree.size() == 20);
+    static_assert(tree.getHeight() == 4);
+    //the first of the repeats of "a" in entry order is i = 0
+    static_assert(tree.get("a") == 0);
+    std::vector<std::string> values = tree.keys();
+    CHECK(values.size() == 20);
+    CHECK(tree.findRange("a", "zz") == values);
+}
@@ -0,0 +1,117 @@
+/**
+ * TTLTests.cpp
+ */
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "TestHarness.h"
+#include "AVLTree.h"
+#include "AVLTrace.h"
+
+using namespace std::chrono_literals;
+
+// keys given shortTTL are read as live right after the write and as expired once afterShortTTL has passed, the
+// margins are wide so a loaded or sanitized run does not cross either one
+static const std::chrono::milliseconds shortTTL = 200ms;
+static const std::chrono::milliseconds afterShortTTL = 600ms;
+
+TEST(TTL, ExpiredKeysAreHiddenUntilSwept) {
+    AVLTree tree;
+    tree.setAggregate(AVLTree::Aggregate::sum());
+    CHECK(tree.insert("short", 1, shortTTL));
+    CHECK(tree.insert("long", 2, 1h));
+    tree.insert("forever", 4);
+    CHECK(tree.expiringKeys() == 2);
+    //a live key keeps its value and its expiry
+    CHECK(!tree.insert("short", 9, 1h));
+    CHECK(tree.get("short") == 1);
+
+    std::this_thread::sleep_for(afterShortTTL);
+    CHECK(!tree.contains("short"));
+    CHECK(!tree.get("short").has_value());
+    CHECK(tree.get("long") == 2);
+    CHECK(!tree.expire("short", 1h));
+    //still counted until the sweep
+    CHECK(tree.size() == 3);
+    CHECK(tree.sweepExpired() == 1);
+    CHECK(tree.size() == 2);
+    CHECK(tree.expiringKeys() == 1);
+    CHECK(tree.aggregateRange("", "~") == 6);
+    CHECK(tree.sweepExpired() == 0);
+    CHECK(tree.checkInvariants());
+}
+
+TEST(TTL, WritingAnExpiredKeyTreatsItAsAbsent) {
+    AVLTree tree;
+    tree.insert("a", 1, shortTTL);
+    tree.upsert("b", 5, [](size_t value) { return value + 1; }, shortTTL);
+    std::this_thread::sleep_for(afterShortTTL);
+    CHECK(tree.insert("a", 2));
+    CHECK(tree.get("a") == 2);
+    CHECK(tree.upsert("b", 5, [](size_t value) { return value + 1; }) == 5);
+    //the plain writes dropped the expiries
+    CHECK(tree.expiringKeys() == 0);
+    std::this_thread::sleep_for(afterShortTTL);
+    CHECK(tree.get("a") == 2);
+    CHECK(tree.get("b") == 5);
+}
+
+TEST(TTL, ExpireMovesTheDeadline) {
+    AVLTree tree;
+    tree.insert("a", 1, shortTTL);
+    tree.insert("b", 2);
+    CHECK(tree.expire("a", 1h));
+    CHECK(tree.expire("b", shortTTL));
+    CHECK(!tree.expire("missing", 1h));
+    //writes without a ttl leave the new expiry alone
+    tree["b"] = 3;
+    std::this_thread::sleep_for(afterShortTTL);
+    CHECK(tree.get("a") == 1);
+    CHECK(!tree.contains("b"));
+    //the stale queue entry for a is skipped
+    CHECK(tree.sweepExpired() == 1);
+    CHECK(tree.size() == 1);
+
+    AVLTree copy(tree);
+    CHECK(copy.expiringKeys() == 1);
+    CHECK(copy.get("a") == 1);
+}
+
+TEST(TTL, RemovingAnExpiredKeyReportsAbsent) {
+    AVLTree tree;
+    tree.setChangeFeed(100);
+    tree.insert("a", 1, shortTTL);
+    tree.insert("b", 2, 1h);
+    std::this_thread::sleep_for(afterShortTTL);
+    CHECK(!tree.contains("a"));
+    uint64_t sequence = tree.changeSequence();
+    CHECK(!tree.remove("a"));
+    //reclaimed and sent to followers as a removal, like a sweep
+    CHECK(tree.size() == 1);
+    CHECK(tree.expiringKeys() == 1);
+    CHECK(tree.changeSequence() == sequence + 1);
+    CHECK(!tree.remove("a"));
+    CHECK(tree.remove("b"));
+    CHECK(tree.sweepExpired() == 0);
+    CHECK(tree.checkInvariants());
+}
+
+TEST(TTL, TracesKeepTheTTL) {
+    std::stringstream trace;
+    TraceRecorder recorder(trace);
+    AVLTree tree;
+    tree.setTraceRecorder(&recorder);
+    tree.insert("a", 1, 1500ms);
+    tree.insert("b", 2);
+    tree.setTraceRecorder(nullptr);
+
+    TraceReader reader(trace);
+    TraceRecord record;
+    CHECK(reader.next(record));
+    CHECK(record.op == TraceOp::InsertTTL and record.key == "a" and record.value == 1 and record.ttl == 1500ms);
+    CHECK(reader.next(record));
+    CHECK(record.op == TraceOp::Insert and record.key == "b" and record.value == 2 and record.ttl == 0ms);
+    CHECK(!reader.next(record));
+}
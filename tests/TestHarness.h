@@ -0,0 +1,55 @@
+/**
+ * TestHarness.h
+ *
+ * Minimal test registry, TEST(suite, name) defines a test and CHECK(condition) records a failure without stopping it
+ */
+
+#ifndef TESTHARNESS_H
+#define TESTHARNESS_H
+#include <string>
+#include <vector>
+#include <functional>
+#include <iostream>
+
+namespace testing {
+
+struct TestCase {
+    std::string suite;
+    std::string name;
+    std::function<void()> body;
+};
+
+// every test registered by TEST, in the order their files were linked
+inline std::vector<TestCase>& registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+// failures in the test that is running
+inline size_t& failures() {
+    static size_t count = 0;
+    return count;
+}
+
+struct Registrar {
+    Registrar(const char* suite, const char* name, std::function<void()> body) {
+        registry().push_back({suite, name, std::move(body)});
+    }
+};
+
+inline void fail(const char* file, int line, const char* condition) {
+    failures()++;
+    std::cerr << file << ":" << line << ": CHECK(" << condition << ") failed" << std::endl;
+}
+
+}
+
+#define TEST(suite, name) \
+    static void suite##_##name(); \
+    static testing::Registrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(condition) \
+    do { if (!(condition)) { testing::fail(__FILE__, __LINE__, #condition); } } while (0)
+
+#endif //TESTHARNESS_H
@@ -0,0 +1,29 @@
+/**
+ * TestMain.cpp
+ *
+ * Runs every registered test, or only the suite named by the first argument. Exits nonzero if any check failed
+ */
+
+#include <iostream>
+#include <string>
+#include "TestHarness.h"
+
+int main(int argc, char* argv[]) {
+    std::string suite = (argc > 1) ? argv[1] : "";
+    size_t run = 0;
+    size_t failed = 0;
+    for (const testing::TestCase& test : testing::registry()) {
+        if (!suite.empty() and test.suite != suite) {
+            continue;
+        }
+        testing::failures() = 0;
+        test.body();
+        run++;
+        if (testing::failures() != 0) {
+            failed++;
+            std::cerr << "FAILED " << test.suite << "." << test.name << std::endl;
+        }
+    }
+    std::cout << run << " tests, " << failed << " failed" << std::endl;
+    return (failed == 0 and run != 0) ? 0 : 1;
+}
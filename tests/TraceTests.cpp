@@ -0,0 +1,84 @@
+/**
+ * TraceTests.cpp
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+#include "AVLTrace.h"
+#include "BinaryIO.h"
+
+TEST(Trace, RecordsEveryCallInOrder) {
+    std::stringstream trace;
+    TraceRecorder recorder(trace);
+    AVLTree tree;
+    tree.setTraceRecorder(&recorder);
+    tree.insert("b", 2);
+    tree.get("b");
+    tree.findRange("a", "c");
+    tree["d"] = 4;
+    tree.remove("b");
+    tree.setTraceRecorder(nullptr);
+    tree.insert("e", 5);
+    CHECK(recorder.recordCount() == 5);
+
+    TraceReader reader(trace);
+    CHECK(reader.good());
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while (reader.next(record)) {
+        records.push_back(record);
+    }
+    CHECK(records.size() == 5);
+    if (records.size() == 5) {
+        CHECK(records[0].op == TraceOp::Insert and records[0].key == "b" and records[0].value == 2);
+        CHECK(records[1].op == TraceOp::Get and records[1].key == "b");
+        CHECK(records[2].op == TraceOp::FindRange and records[2].key == "a" and records[2].highKey == "c");
+        CHECK(records[3].op == TraceOp::Index and records[3].key == "d");
+        CHECK(records[4].op == TraceOp::Remove and records[4].key == "b");
+        for (size_t i = 1; i < records.size(); i++) {
+            CHECK(records[i - 1].timestamp <= records[i].timestamp);
+        }
+    }
+}
+
+TEST(Trace, RejectsOtherStreams) {
+    std::stringstream notTrace("AVLX\x01");
+    TraceReader reader(notTrace);
+    CHECK(!reader.good());
+    TraceRecord record;
+    CHECK(!reader.next(record));
+}
+
+TEST(Trace, TruncatedRecordStops) {
+    std::stringstream trace;
+    TraceRecorder recorder(trace);
+    recorder.record(TraceOp::Insert, "first", 1);
+    recorder.record(TraceOp::Insert, "second key", 2);
+    std::string bytes = trace.str();
+    std::stringstream cut(bytes.substr(0, bytes.size() - 4));
+    TraceReader reader(cut);
+    TraceRecord record;
+    CHECK(reader.next(record) and record.key == "first");
+    CHECK(!reader.next(record));
+}
+
+TEST(Trace, CorruptStringLengthFails) {
+    //a length near 2^63 followed by a few bytes must fail without trying to allocate it
+    std::stringstream corrupt;
+    writeVarint(corrupt, UINT64_C(1) << 62);
+    corrupt.write("abc", 3);
+    std::string str;
+    CHECK(!readString(corrupt, str));
+    CHECK(str.size() <= 3);
+
+    std::stringstream good;
+    std::string large(200 * 1024, 'x');
+    writeString(good, large);
+    writeString(good, "");
+    CHECK(readString(good, str) and str == large);
+    CHECK(readString(good, str) and str.empty());
+    CHECK(!readString(good, str));
+}
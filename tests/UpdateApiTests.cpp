@@ -0,0 +1,80 @@
+/**
+ * UpdateApiTests.cpp
+ */
+
+#include <map>
+#include <random>
+#include <string>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+TEST(UpdateApi, MatchesModelUnderRandomOps) {
+    std::mt19937 rng(27);
+    AVLTree tree;
+    tree.setAggregate(AVLTree::Aggregate::sum());
+    std::map<std::string, size_t> model;
+    for (int i = 0; i < 30000; i++) {
+        std::string key = std::to_string(rng() % 2000);
+        size_t value = rng() % 100;
+        switch (rng() % 5) {
+            case 0:
+                CHECK(tree.insert_or_assign(key, value) == (model.count(key) == 0));
+                model[key] = value;
+                break;
+            case 1: {
+                auto [stored, inserted] = tree.try_emplace(key, value);
+                CHECK(inserted == (model.count(key) == 0));
+                model.emplace(key, value);
+                CHECK(stored == model[key]);
+                break;
+            }
+            case 2: {
+                bool found = tree.update(key, [](size_t old) { return old + 1; });
+                CHECK(found == (model.count(key) == 1));
+                if (found) {
+                    model[key]++;
+                }
+                break;
+            }
+            case 3: {
+                size_t& stored = tree.upsert(key, 7, [](size_t old) { return old * 2; });
+                auto it = model.find(key);
+                if (it == model.end()) {
+                    model[key] = 7;
+                }
+                else {
+                    it->second *= 2;
+                }
+                CHECK(stored == model[key]);
+                break;
+            }
+            default:
+                CHECK(tree.remove(key) == (model.erase(key) == 1));
+        }
+        if (i % 1000 == 0) {
+            CHECK(tree.checkInvariants());
+        }
+    }
+    CHECK(tree.checkInvariants());
+    CHECK(tree.size() == model.size());
+    size_t sum = 0;
+    for (const auto& [key, value] : model) {
+        sum += value;
+        CHECK(tree.get(key) == value);
+    }
+    CHECK(tree.aggregateRange("", "~") == sum);
+}
+
+TEST(UpdateApi, ReturnedReferencesWriteThrough) {
+    AVLTree tree;
+    auto [stored, inserted] = tree.try_emplace("a", 1);
+    CHECK(inserted);
+    stored = 5;
+    CHECK(tree.get("a") == 5);
+    CHECK(!tree.try_emplace("a", 9).second);
+    CHECK(tree.get("a") == 5);
+    tree.upsert("b", 3, [](size_t old) { return old; }) = 4;
+    CHECK(tree.get("b") == 4);
+    CHECK(!tree.update("missing", [](size_t old) { return old; }));
+    CHECK(!tree.contains("missing"));
+}
@@ -0,0 +1,90 @@
+/**
+ * WAVLTests.cpp
+ */
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+TEST(WAVL, InvariantsAfterRandomOps) {
+    for (AVLTree::BalancePolicy policy : {AVLTree::BalancePolicy::AVL, AVLTree::BalancePolicy::WAVL}) {
+        std::mt19937 rng(31);
+        AVLTree tree(policy);
+        tree.setAggregate(AVLTree::Aggregate::sum());
+        std::map<std::string, size_t> model;
+        for (int i = 0; i < 100000; i++) {
+            std::string key = std::to_string(rng() % 5000);
+            if (rng() % 2 == 0) {
+                size_t value = rng() % 100;
+                CHECK(tree.insert(key, value) == (model.count(key) == 0));
+                model.emplace(key, value);
+            }
+            else {
+                CHECK(tree.remove(key) == (model.erase(key) == 1));
+            }
+            if (i % 2000 == 0) {
+                CHECK(tree.checkInvariants());
+            }
+        }
+        CHECK(tree.checkInvariants());
+        CHECK(tree.size() == model.size());
+        //rank is at most 2 log2(n) under WAVL, the height of an AVL tree is below 1.45 log2(n + 2)
+        CHECK(tree.getHeight() <= 2 * std::log2(model.size()) + 1);
+        AVLTree copy(tree);
+        CHECK(copy.getBalancePolicy() == policy);
+        CHECK(copy.checkInvariants());
+    }
+}
+
+TEST(WAVL, FewerRotationsOnDeleteHeavyWork) {
+    size_t rotations[2];
+    for (int policy = 0; policy < 2; policy++) {
+        std::mt19937 rng(3100);
+        AVLTree tree(policy == 0 ? AVLTree::BalancePolicy::AVL : AVLTree::BalancePolicy::WAVL);
+        for (int i = 0; i < 50000; i++) {
+            std::string key = std::to_string(rng() % 20000);
+            if (rng() % 3 == 0) {
+                tree.insert(key, i);
+            }
+            else {
+                tree.remove(key);
+            }
+            if (i % 10 == 0) {
+                tree.insert(std::to_string(rng() % 20000), i);
+            }
+        }
+        rotations[policy] = tree.rotations();
+    }
+    CHECK(rotations[1] <= rotations[0]);
+}
+
+TEST(WAVL, SwitchingPolicies) {
+    AVLTree tree;
+    for (size_t i = 0; i < 100; i++) {
+        tree.insert(std::to_string(i), i);
+    }
+    CHECK(tree.setBalancePolicy(AVLTree::BalancePolicy::WAVL));
+    for (size_t i = 0; i < 100; i += 2) {
+        tree.remove(std::to_string(i));
+    }
+    CHECK(tree.checkInvariants());
+    CHECK(!tree.setBalancePolicy(AVLTree::BalancePolicy::AVL));
+    CHECK(tree.getBalancePolicy() == AVLTree::BalancePolicy::WAVL);
+
+    AVLTree empty(AVLTree::BalancePolicy::WAVL);
+    CHECK(empty.setBalancePolicy(AVLTree::BalancePolicy::AVL));
+}
+
+TEST(WAVL, WithEviction) {
+    AVLTree tree(AVLTree::BalancePolicy::WAVL);
+    tree.setCapacity(50, 0, AVLTree::EvictionPolicy::Clock);
+    for (size_t i = 0; i < 3000; i++) {
+        tree.insert(std::to_string(i * 7919 % 3001), i);
+        tree.get(std::to_string(i % 77));
+    }
+    CHECK(tree.size() == 50);
+    CHECK(tree.checkInvariants());
+}
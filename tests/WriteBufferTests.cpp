@@ -0,0 +1,145 @@
+/**
+ * WriteBufferTests.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestHarness.h"
+#include "AVLTree.h"
+
+// fixed width key so key order and the order of i agree
+static std::string paddedKey(size_t i) {
+    char key[16];
+    std::snprintf(key, sizeof(key), "k%06zu", i);
+    return key;
+}
+
+// values of model with lowKey <= key <= highKey in key order, as findRange returns them
+static std::vector<std::string> modelRange(const std::map<std::string, size_t>& model, const std::string& lowKey,
+                                           const std::string& highKey) {
+    std::vector<std::string> values;
+    for (auto it = model.lower_bound(lowKey); it != model.end() and it->first <= highKey; ++it) {
+        values.push_back(std::to_string(it->second));
+    }
+    return values;
+}
+
+TEST(WriteBuffer, MatchesModelUnderRandomOps) {
+    for (bool filtered : {false, true}) {
+        std::mt19937 rng(33);
+        AVLTree tree;
+        tree.setAggregate(AVLTree::Aggregate::sum());
+        if (filtered) {
+            tree.setFilter(1000);
+        }
+        tree.setWriteBuffer(32, std::chrono::milliseconds(0));
+        std::map<std::string, size_t> model;
+        for (int i = 0; i < 20000; i++) {
+            std::string key = paddedKey(rng() % 3000);
+            switch (rng() % 6) {
+                case 0:
+                case 1:
+                case 2: {
+                    size_t value = rng() % 1000;
+                    CHECK(tree.insert(key, value) == (model.count(key) == 0));
+                    model.emplace(key, value);
+                    break;
+                }
+                case 3:
+                    CHECK(tree.remove(key) == (model.erase(key) == 1));
+                    break;
+                case 4:
+                    tree.insert_or_assign(key, i);
+                    model[key] = i;
+                    break;
+                default: {
+                    auto it = model.find(key);
+                    CHECK(tree.get(key) == (it == model.end() ? std::nullopt : std::optional<size_t>(it->second)));
+                }
+            }
+            if (i % 500 == 0) {
+                CHECK(tree.checkInvariants());
+                CHECK(tree.size() == model.size());
+                std::string lowKey = paddedKey(rng() % 3000);
+                std::string highKey = paddedKey(rng() % 3000);
+                if (highKey < lowKey) {
+                    std::swap(lowKey, highKey);
+                }
+                CHECK(tree.findRange(lowKey, highKey) == modelRange(model, lowKey, highKey));
+                size_t sum = 0;
+                for (auto it = model.lower_bound(lowKey); it != model.end() and it->first <= highKey; ++it) {
+                    sum += it->second;
+                }
+                CHECK(tree.aggregateRange(lowKey, highKey) == sum);
+            }
+        }
+        tree.flushWriteBuffer();
+        CHECK(tree.checkInvariants());
+        CHECK(tree.keys() == modelRange(model, "", "~"));
+    }
+}
+
+TEST(WriteBuffer, ReadsKeepKeyOrder) {
+    AVLTree tree;
+    for (size_t i = 0; i < 100; i += 2) {
+        tree.insert(paddedKey(i), i);
+    }
+    tree.setWriteBuffer(1000, std::chrono::milliseconds(0));
+    for (size_t i = 1; i < 100; i += 2) {
+        tree.insert(paddedKey(i), i);
+    }
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 100; i++) {
+        expected.push_back(std::to_string(i));
+    }
+    CHECK(tree.keys() == expected);
+    std::vector<std::string> range(expected.begin() + 10, expected.begin() + 21);
+    CHECK(tree.findRange(paddedKey(10), paddedKey(20)) == range);
+    CHECK(tree.findRange(paddedKey(20), paddedKey(10)).empty());
+    CHECK(tree.size() == 100);
+    tree.flushWriteBuffer();
+    CHECK(tree.keys() == expected);
+    CHECK(tree.checkInvariants());
+}
+
+TEST(WriteBuffer, FlushesWhenFullOrOld) {
+    AVLTree tree;
+    tree.setWriteBuffer(4, std::chrono::milliseconds(0));
+    for (size_t i = 0; i < 3; i++) {
+        tree.insert(paddedKey(i), i);
+    }
+    CHECK(tree.checkInvariants());
+    CHECK(tree.size() == 3);
+    //the fourth key fills the buffer and merges it
+    tree.insert(paddedKey(3), 3);
+    tree.setWriteBuffer(0, std::chrono::milliseconds(0));
+    CHECK(tree.size() == 4);
+
+    AVLTree aged;
+    aged.setWriteBuffer(1000, std::chrono::milliseconds(1));
+    aged.insert("a", 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    //only insert checks the age, an idle buffer waits for flushWriteBuffer
+    CHECK(aged.get("a") == 1);
+    aged.insert("b", 2);
+    CHECK(aged.checkInvariants());
+    CHECK(aged.findRange("a", "b") == std::vector<std::string>({"1", "2"}));
+}
+
+TEST(WriteBuffer, InPlaceWritesMergeFirst) {
+    AVLTree tree;
+    tree.setWriteBuffer(100, std::chrono::milliseconds(0));
+    tree.insert("a", 1);
+    tree["a"] = 5;
+    CHECK(tree.get("a") == 5);
+    tree.insert("b", 2);
+    CHECK(tree.update("b", [](size_t value) { return value * 10; }));
+    CHECK(tree.get("b") == 20);
+    CHECK(!tree.insert("b", 3));
+    CHECK(tree.checkInvariants());
+}